@@ -0,0 +1,236 @@
+/* EMS benchmark ("ems_bench [students] [exams]")
+ * Times the storage engine and the reports on synthetic data, so they can be measured without a terminal.
+ * The data is generated in BENCH_DIRECTORY, which is removed afterwards.
+ */
+#include "console.h"
+#include "storage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+const char BENCH_DIRECTORY[] = "bench-data";
+const unsigned int BENCH_STUDENTS = 1000;
+const unsigned int BENCH_EXAMS = 50;
+const unsigned int BENCH_EXAMS_PER_STUDENT = 3;
+// Questions of each exam, the last BENCH_ESSAY_COUNT of them are essay questions
+const unsigned int BENCH_QUESTION_COUNT = 20;
+const unsigned int BENCH_ESSAY_COUNT = 4;
+// Number of times each listing is timed
+const unsigned int BENCH_LISTING_COUNT = 20;
+
+void print_benchmark_result(const char *operation, vector<double> *latencies, double total_seconds);
+int run_benchmark(unsigned int student_count, unsigned int exam_count);
+
+int main(int argc, char *argv[])
+{
+    unsigned int student_count = argc > 1 ? strtoul(argv[1], NULL, 10) : BENCH_STUDENTS;
+    unsigned int exam_count = argc > 2 ? strtoul(argv[2], NULL, 10) : BENCH_EXAMS;
+    if (argc > 3 || student_count == 0 || exam_count == 0)
+    {
+        cout << "Usage: " << argv[0] << " [students] [exams]\n";
+        return 1;
+    }
+    if (run_benchmark(student_count, exam_count) == -1)
+    {
+        cout << "*** Error: Couldn't run the benchmark, check the permission to write into ./" << BENCH_DIRECTORY << ". ***\n";
+        return 1;
+    }
+    return 0;
+}
+
+void print_benchmark_result(const char *operation, vector<double> *latencies, double total_seconds)
+{
+    // Prints the throughput and the latency percentiles (in microseconds) of a timed operation
+    char line[256];
+    if (latencies->empty()) return;
+    sort(latencies->begin(), latencies->end());
+    size_t count = latencies->size();
+    auto percentile = [&](double fraction) { return (*latencies)[min(count - 1, (size_t)(fraction * count))]; };
+    snprintf(line, sizeof(line), "%-22s %8zu %12.1f %10.1f %10.1f %10.1f %10.1f\n", operation, count,
+             total_seconds > 0 ? count / total_seconds : 0.0, percentile(0.5), percentile(0.9), percentile(0.99),
+             (*latencies)[count - 1]);
+    cout << line;
+}
+
+int run_benchmark(unsigned int student_count, unsigned int exam_count)
+{
+    /* Fills a scratch data directory (BENCH_DIRECTORY, removed afterwards) with student_count students and
+     * exam_count exams, each student takes BENCH_EXAMS_PER_STUDENT of the exams. Then times logging in,
+     * submitting exams, the results report and the listings, and prints their throughput and latency percentiles.
+     * Returns 0 on success or -1 if the scratch directory couldn't be used
+     */
+    error_code error;
+    filesystem::path working_directory = filesystem::current_path(error);
+    filesystem::remove_all(BENCH_DIRECTORY, error);
+    filesystem::create_directory(BENCH_DIRECTORY, error);
+    if (!error) filesystem::current_path(BENCH_DIRECTORY, error);
+    if (error || !create_data_directory()) return -1;
+
+    // The data is the same in every run
+    mt19937 generator(2022);
+    typedef chrono::steady_clock bench_clock;
+    auto elapsed_us = [](bench_clock::time_point start) {
+        return chrono::duration<double, micro>(bench_clock::now() - start).count();
+    };
+    bench_clock::time_point start, section_start;
+    vector<double> latencies;
+
+    // Users: a manager, a professor for every 100 students and the students
+    unsigned int professor_count = student_count / 100 + 1;
+    vector<User> new_users(1 + professor_count + student_count);
+    for (size_t i = 0; i < new_users.size(); i++)
+    {
+        User &user = new_users[i];
+        memset(&user, 0, sizeof(user));
+        user.role = i == 0 ? 'M' : (i <= professor_count ? 'P' : 'S');
+        snprintf(user.username, sizeof(user.username), "%s%zu", i == 0 ? "manager" : (user.role == 'P' ? "prof" : "student"), i);
+        snprintf(user.fname, sizeof(user.fname), "First%zu", i);
+        snprintf(user.lname, sizeof(user.lname), "Last%u", (unsigned int)(generator() % 100000));
+        snprintf(user.password, sizeof(user.password), "password%zu", i);
+    }
+    {
+        RecordFile<User> users_file("./data/users.dat", true);
+        users_file.append(new_users.data(), new_users.size());
+    }
+    sync_users_index();
+    update_users_by_lname_index();
+
+    // Exams, the last BENCH_ESSAY_COUNT questions of each exam are essay questions
+    vector<Exam> exams(exam_count);
+    time_t time_now = time(NULL);
+    section_start = bench_clock::now();
+    for (unsigned int e = 0; e < exam_count; e++)
+    {
+        start = bench_clock::now();
+        Exam &exam = exams[e];
+        memset(&exam, 0, sizeof(exam));
+        snprintf(exam.name, sizeof(exam.name), "Benchmark exam %u", e + 1);
+        strcpy(exam.creator_username, new_users[1 + e % professor_count].username);
+        exam.qcount = BENCH_QUESTION_COUNT;
+        exam.start_time = time_now - (time_t)(generator() % (365 * 24 * 3600));
+        exam.end_time = exam.start_time + 2 * 3600;
+
+        vector<Question> questions(BENCH_QUESTION_COUNT);
+        for (unsigned int q = 0; q < BENCH_QUESTION_COUNT; q++)
+        {
+            Question &question = questions[q];
+            memset(&question, 0, sizeof(question));
+            question.qnum = q + 1;
+            question.is_multiple_choice = q < BENCH_QUESTION_COUNT - BENCH_ESSAY_COUNT;
+            snprintf(question.question, sizeof(question.question), "Question %u of exam %u", q + 1, e + 1);
+            if (question.is_multiple_choice)
+            {
+                strcpy(question.opt1, "first option");
+                strcpy(question.opt2, "second option");
+                strcpy(question.opt3, "third option");
+                strcpy(question.opt4, "fourth option");
+                question.correct = "abcd"[generator() % 4];
+            }
+        }
+
+        char questions_path[MAX_CHAR_ARR_LENGTH];
+        generate_exam_id(&exam);
+        create_examQ_path(questions_path, exam.id);
+        if (!replace_file(questions_path, string((const char *)questions.data(), questions.size() * sizeof(Question))) ||
+            !create_exam_files(&exam) || !save_exam(&exam))
+            return -1;
+        latencies.push_back(elapsed_us(start));
+    }
+    cout << "EMS benchmark: " << student_count << " students, " << professor_count << " professors, " << exam_count << " exams\n\n";
+    cout << "Operation                 Count        Ops/s   p50 (us)   p90 (us)   p99 (us)   Max (us)\n";
+    print_benchmark_result("add exam", &latencies, elapsed_us(section_start) / 1e6);
+    latencies.clear();
+
+    // Submissions, timed like the end of take_exam()
+    vector<char> choices(BENCH_QUESTION_COUNT);
+    vector<Answer> essay_answers(BENCH_ESSAY_COUNT);
+    unsigned int exams_per_student = min(BENCH_EXAMS_PER_STUDENT, exam_count);
+    section_start = bench_clock::now();
+    for (unsigned int s = 0; s < student_count; s++)
+    {
+        const User &student = new_users[1 + professor_count + s];
+        for (unsigned int k = 0; k < exams_per_student; k++)
+        {
+            const Exam &exam = exams[(s + k) % exam_count];
+            for (unsigned int q = 0; q < BENCH_QUESTION_COUNT; q++)
+                choices[q] = q < BENCH_QUESTION_COUNT - BENCH_ESSAY_COUNT ? "abcdx"[generator() % 5] : '\0';
+            for (unsigned int a = 0; a < BENCH_ESSAY_COUNT; a++)
+            {
+                Answer &answer = essay_answers[a];
+                memset(&answer, 0, sizeof(answer));
+                strcpy(answer.exam_id, exam.id);
+                strcpy(answer.username, student.username);
+                answer.qnum = BENCH_QUESTION_COUNT - BENCH_ESSAY_COUNT + a + 1;
+                snprintf(answer.essay_answer, sizeof(answer.essay_answer), "Essay answer %u of %s, %u words long",
+                         a + 1, student.username, (unsigned int)(generator() % 500));
+            }
+
+            start = bench_clock::now();
+            submit_exam(&exam, student.username, choices.data(), essay_answers.data(), essay_answers.size());
+            latencies.push_back(elapsed_us(start));
+        }
+    }
+    print_benchmark_result("take exam (submit)", &latencies, elapsed_us(section_start) / 1e6);
+    latencies.clear();
+
+    // Logging in, every student once
+    section_start = bench_clock::now();
+    for (unsigned int s = 0; s < student_count; s++)
+    {
+        const User &student = new_users[1 + professor_count + s];
+        start = bench_clock::now();
+        authenticate_user(student.username, student.password);
+        latencies.push_back(elapsed_us(start));
+    }
+    print_benchmark_result("login", &latencies, elapsed_us(section_start) / 1e6);
+    latencies.clear();
+
+    /* The reports and listings are run as a professor, with their output discarded and the input ended,
+     * so they render their first page and return without waiting for the user
+     */
+    struct NullBuffer : streambuf
+    {
+        int overflow(int c) { return c; }
+    } null_buffer;
+    streambuf *cout_buffer = cout.rdbuf(&null_buffer);
+#ifdef _WIN32
+    FILE *null_input = freopen("NUL", "r", stdin);
+#else
+    FILE *null_input = freopen("/dev/null", "r", stdin);
+#endif
+    loggedin_user = new_users[1];
+    vector<double> results_latencies, exams_latencies, users_latencies;
+    double results_seconds = 0, exams_seconds = 0, users_seconds = 0;
+    for (unsigned int e = 0; null_input != NULL && e < exam_count; e++)
+    {
+        start = bench_clock::now();
+        print_exam_results(&exams[e]);
+        results_latencies.push_back(elapsed_us(start));
+        results_seconds += results_latencies.back() / 1e6;
+    }
+    for (unsigned int i = 0; null_input != NULL && i < BENCH_LISTING_COUNT; i++)
+    {
+        start = bench_clock::now();
+        list_all_exams();
+        exams_latencies.push_back(elapsed_us(start));
+        exams_seconds += exams_latencies.back() / 1e6;
+
+        start = bench_clock::now();
+        list_all_users('S');
+        users_latencies.push_back(elapsed_us(start));
+        users_seconds += users_latencies.back() / 1e6;
+    }
+    cout.rdbuf(cout_buffer);
+    print_benchmark_result("exam results report", &results_latencies, results_seconds);
+    print_benchmark_result("list all exams", &exams_latencies, exams_seconds);
+    print_benchmark_result("list all users", &users_latencies, users_seconds);
+
+    filesystem::current_path(working_directory, error);
+    filesystem::remove_all(BENCH_DIRECTORY, error);
+    return 0;
+}
@@ -0,0 +1,1714 @@
+#include "console.h"
+
+#include <cstdlib>
+#include <iostream>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+// Older MinGW headers don't have it
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#endif
+
+using namespace std;
+
+User loggedin_user;
+
+#ifdef _WIN32
+// false if the console doesn't handle ANSI escape sequences (older than Windows 10), see init_console()
+bool console_escapes = true;
+#endif
+
+void on_startup()
+{
+    init_console();
+    // Creating ./data directory if it doesn't exist to store the files inside it
+    if (!create_data_directory())
+    {
+        cout << "*** Error: Couldn't create the data directory. Make sure you have the "
+                "permission to write into this directory. ***\n";
+        exit(1);
+    }
+
+    clear_console();
+    // Checking if it's the first time the program is being run
+    bool is_first_startup;
+    FILE *file_ptr;
+    file_ptr = fopen("./data/is_first_startup.dat", "a+");
+    if (file_ptr == NULL)
+    {
+        cout << "*** Error: Make sure you have enough disk space, and the "
+                "permission to read from or write into files. ***\n";
+        cout << "Exiting EMS...";
+        exit(0);
+    }
+    size_t data_read_s = fread(&is_first_startup, sizeof(is_first_startup), 1, file_ptr);
+    fclose(file_ptr);
+    if (data_read_s == 0 || is_first_startup)
+    {
+        setup();
+        is_first_startup = false;
+        file_ptr = fopen("./data/is_first_startup.dat", "a+");
+        fwrite(&is_first_startup, sizeof(is_first_startup), 1, file_ptr);
+        fclose(file_ptr);
+    }
+
+    // Loading the users and exams indexes once, lookups afterwards only read newly added records
+    sync_users_index();
+    sync_exams_index();
+
+    // Submitting the answers of exam sessions which didn't end (EMS crashed or the terminal was closed)
+    replay_answer_logs();
+
+    // Logging in and taking exams are done by the EMS server if one is running ("ems serve")
+    connect_to_server();
+
+    // Loops until valid login, or until the input has ended (e.g. the terminal was closed)
+    while (!login_screen())
+    {
+        if (input_ended()) return;
+        cout << "\t*** Error: The username or password you entered is incorrect. "
+                "Make sure you are registered as a user. ***\n";
+        wait_on_enter();
+    }
+
+    // Successful login message
+    cout << "\tSuccess: You've logged in as " << loggedin_user.fname << " " << loggedin_user.lname;
+    cout << " (";
+    if (loggedin_user.role == 'M')
+        cout << "Manager";
+    else if (loggedin_user.role == 'P')
+        cout << "Professor";
+    else if (loggedin_user.role == 'S')
+        cout << "Student";
+    else
+        cout << "Undefined";
+    cout << ").\n";
+    wait_on_enter();
+
+    show_main_menu();
+}
+
+void setup()
+{
+    cout << "########## Welcome to EMS! ##########\n";
+    cout << "Just because you are the first one running this program, you are "
+            "the one and only manager!\n";
+
+    // Creating needed files
+    FILE *file_ptr;
+    file_ptr = fopen("./data/users.dat", "w");
+    fclose(file_ptr);
+    file_ptr = fopen("./data/exams.dat", "w");
+    fclose(file_ptr);
+    file_ptr = fopen("./data/exams.idx", "w");
+    fclose(file_ptr);
+    file_ptr = fopen("./data/enrollments.dat", "w");
+    fclose(file_ptr);
+    file_ptr = fopen(USERS_BY_LNAME_INDEX_PATH, "w");
+    fclose(file_ptr);
+    file_ptr = fopen(EXAMS_BY_START_INDEX_PATH, "w");
+    fclose(file_ptr);
+
+    // First user using EMS is counted as the manager
+    loggedin_user.role = 'M';
+    if (register_user(&loggedin_user))
+    {
+        cout << "Registrion not successful, Exiting...\n";
+        exit(0);
+    }
+}
+
+bool login_screen()
+{
+    char username[MAX_CHAR_ARR_LENGTH], password[MAX_CHAR_ARR_LENGTH];
+    // Nobody is logged in until the login succeeds (the metrics of a failed login have no user)
+    loggedin_user = User();
+    OperationTimer operation_timer("login");
+
+    clear_console();
+
+    cout << "##### Login #####\n";
+    cout << "\tUsername: ";
+    read_input(username);
+    cout << "\tPassword: ";
+    read_input(password);
+    if (input_ended())
+    {
+        // Nothing was logged in, so there's no login to record
+        operation_timer.cancel();
+        return false;
+    }
+
+    // Checking the login by the server, it replies with the user if the login is valid
+    string response;
+    if (server_request(string("L") + username + '\0' + password + '\0', &response))
+    {
+        if (response[0] != SERVER_OK || response.size() != 1 + sizeof(User)) return false;
+        memcpy(&loggedin_user, response.data() + 1, sizeof(User));
+        return true;
+    }
+
+    const User *user = authenticate_user(username, password);
+    if (user == NULL) return false;
+
+    loggedin_user = *user;
+    return true;
+}
+
+void show_main_menu()
+{
+    // Runs the menu of the logged in user until they log out, the menus loop here instead of calling themselves
+    MenuState state;
+    switch (loggedin_user.role)
+    {
+    case 'M':
+        state = MENU_MANAGER;
+        break;
+    case 'P':
+        state = MENU_PROFESSOR;
+        break;
+    case 'S':
+        state = MENU_STUDENT;
+        break;
+    default:
+        cout << "\t*** Undefined role. ***\n";
+        return;
+    }
+
+    while (state != MENU_EXIT)
+    {
+        clear_console();
+        welcome_user(&loggedin_user);
+        cout << "\t(0) Refresh\n";
+
+        // Rendering different menus depending on the user role
+        switch (state)
+        {
+        case MENU_MANAGER:
+            state = show_manager_menu();
+            break;
+        case MENU_PROFESSOR:
+            state = show_professor_menu();
+            break;
+        case MENU_STUDENT:
+            state = show_student_menu();
+            break;
+        default:
+            state = MENU_EXIT;
+        }
+
+        // Nothing more can be read if the input has ended (e.g. the terminal was closed)
+        if (cin.eof()) state = MENU_EXIT;
+    }
+}
+
+MenuState show_manager_menu()
+{
+    char menu_code;
+    cout << "\t(1) List all students\n";
+    cout << "\t(2) List all professors\n";
+    cout << "\t(3) List all exams\n";
+    cout << "\t(4) Add a new user\n";
+    cout << "\t(5) Logout\n";
+
+    cout << "\nEnter menu option code: ";
+    cin >> menu_code;
+    cin.ignore();
+
+    switch (menu_code)
+    {
+    case '0':
+        break;
+    case '1':
+        list_all_users('S');
+        break;
+    case '2':
+        list_all_users('P');
+        break;
+    case '3':
+        list_all_exams();
+        break;
+    case '4':
+        User new_user;
+        /* Fixes the bug that newly created User struct equals to loggedin user
+         * Initializing user role to 'X' so the role selection will appear in register_user() function
+         */
+        new_user.role = 'X';
+        register_user(&new_user);
+        break;
+    case '5':
+        if (logout(loggedin_user)) return MENU_EXIT;
+        break;
+    default:
+        cout << "\t*** Error: Undefined menu code. Try again. ***\n";
+        wait_on_enter();
+    }
+    return MENU_MANAGER;
+}
+
+MenuState show_professor_menu()
+{
+    char menu_code;
+    cout << "\t(1) List all students\n";
+    cout << "\t(2) List all exams\n";
+    cout << "\t(3) See exam results\n";
+    cout << "\t(4) See student answers\n";
+    cout << "\t(5) Add a new exam\n";
+    cout << "\t(6) Correct an answer key\n";
+    cout << "\t(7) Logout\n";
+
+    cout << "\nEnter menu option code: ";
+    cin >> menu_code;
+    cin.ignore();
+
+    switch (menu_code)
+    {
+    case '0':
+        break;
+    case '1':
+        list_all_users('S');
+        break;
+    case '2':
+        list_all_exams();
+        break;
+    case '3':
+        show_exam_results_P();
+        break;
+    case '4':
+        show_exam_answers();
+        break;
+    case '5':
+        Exam new_exam;
+        add_exam(&new_exam);
+        break;
+    case '6':
+        correct_answer_key();
+        break;
+    case '7':
+        if (logout(loggedin_user)) return MENU_EXIT;
+        break;
+    default:
+        cout << "\t*** Error: Undefined menu code. Try again. ***\n";
+        wait_on_enter();
+    }
+    return MENU_PROFESSOR;
+}
+
+MenuState show_student_menu()
+{
+    char menu_code;
+    cout << "\t(1) List all exams\n";
+    cout << "\t(2) Take an exam\n";
+    cout << "\t(3) Exam results\n";
+    cout << "\t(4) Exam answers\n";
+    cout << "\t(5) Logout\n";
+
+    cout << "\nEnter menu option code: ";
+    cin >> menu_code;
+    cin.ignore();
+
+    switch (menu_code)
+    {
+    case '0':
+        break;
+    case '1':
+        list_all_exams();
+        break;
+    case '2':
+        take_exam();
+        break;
+    case '3':
+        show_exam_results_S();
+        break;
+    case '4':
+        show_exam_answers();
+        break;
+    case '5':
+        if (logout(loggedin_user)) return MENU_EXIT;
+        break;
+    default:
+        cout << "\t*** Error: Undefined menu code. Try again. ***\n";
+        wait_on_enter();
+    }
+    return MENU_STUDENT;
+}
+
+void welcome_user(User *user)
+{
+    time_t curr_time = time(NULL);
+    cout << "##########";
+    cout << " Welcome to EMS! ";
+    cout << user->fname << " " << user->lname << " ";
+    cout << "(Role: ";
+    if (user->role == 'M')
+        cout << "Manager";
+    else if (user->role == 'P')
+        cout << "Professor";
+    else if (user->role == 'S')
+        cout << "Student";
+    else
+        cout << "Undefined";
+    cout << ") ";
+    cout << "##########\n";
+    tm *now_timedate = localtime(&curr_time);
+    cout << "Today: ";
+    print_date(now_timedate);
+    cout << ' ';
+    print_time(now_timedate);
+    cout << '\n';
+}
+
+int register_user(User *user)
+{
+    cout << "Registring new user\n";
+    char password[MAX_CHAR_ARR_LENGTH];
+    char password_repeat[MAX_CHAR_ARR_LENGTH];
+    if (user->role != 'M')
+    {
+        cout << "\tEnter the role of the user [(S)tudent|(P)rofessor]: ";
+        cin >> user->role;
+        cin.ignore();
+        while (user->role != 'S' && user->role != 'P')
+        {
+            cout << "\t*** Error: The entered role was undefined, please enter "
+                    "either S or P ***\n";
+            cin >> user->role;
+            cin.ignore();
+        }
+    }
+    cout << "\tFirst name: ";
+    read_input(user->fname);
+    // Captalizing first name
+    if (user->fname[0] >= 'a' && user->fname[0] <= 'z') user->fname[0] -= 'a' - 'A';
+    cout << "\tLast name: ";
+    read_input(user->lname);
+    // Captalizing last name
+    if (user->lname[0] >= 'a' && user->lname[0] <= 'z') user->lname[0] -= 'a' - 'A';
+
+    // Checking if username is already taken by other users
+    cout << "\tUsername: ";
+    read_input(user->username);
+    while (username_exists(user->username))
+    {
+        cout << "\t*** Error: username exists, enter another one. ***\n";
+        cout << "\tUsername: ";
+        read_input(user->username);
+    }
+
+    cout << "\tCreate a password: ";
+    read_input(password);
+    cout << "\tRepeat the password: ";
+    read_input(password_repeat);
+    while (!validate_password(password, password_repeat))
+    {
+        cout << "\tTry again!\n";
+        cout << "\tCreate a password: ";
+        read_input(password);
+        cout << "\tRepeat the password: ";
+        read_input(password_repeat);
+    }
+    strcpy(user->password, password);
+
+    /* Saving User struct
+     * users.dat is locked and the username is checked again, since another process might have
+     * registered the same username while the password was being entered
+     */
+    RecordFile<User> users_file("./data/users.dat", true);
+    size_t data_written_s = 0;
+    if (users_file.lock())
+    {
+        sync_users_index();
+        if (username_exists(user->username))
+        {
+            users_file.unlock();
+            cout << "\t*** Error: username \"" << user->username << "\" was registered meanwhile, try again. ***\n";
+            wait_on_enter();
+            return -1;
+        }
+        data_written_s = users_file.append(user);
+        users_file.unlock();
+    }
+
+    // Adding the new user (and any user registered meanwhile by other processes) to the indexes
+    sync_users_index();
+    update_users_by_lname_index();
+
+    if (data_written_s == 1)
+    {
+        cout << '\t' << user->fname << ' ' << user->lname
+             << " has been successfully registered as ";
+        if (user->role == 'M')
+            cout << "the manager";
+        else if (user->role == 'P')
+            cout << "a professor";
+        else if (user->role == 'S')
+            cout << "a student";
+        else
+        {
+            cout << "*** Internal Error: Undefined role for user ***\n";
+            exit(0);
+        }
+        cout << ".\n";
+        wait_on_enter();
+        return 0;
+    }
+    else
+    {
+        cout
+            << "\t*** Could not save user info, check for file permissions and "
+               "disk space and then try again. ***\n";
+        wait_on_enter();
+        return -1;
+    }
+}
+
+int add_exam(Exam *new_exam)
+{
+    tm exam_time;
+    cout << "\tEnter the name of the exam: ";
+    read_input(new_exam->name);
+    cout << "\tHow many questions does the exam have? ";
+    cin >> new_exam->qcount;
+    cin.ignore();
+    while (new_exam->qcount <= 0)
+    {
+        cout << "\t*** Error: The number of questions cannot be less than 1 ***\n";
+        cout << "\tHow many questions does the exam have? ";
+        cin >> new_exam->qcount;
+        cin.ignore();
+    }
+    while (true)
+    {
+        cin.sync();
+        time_t time_now;
+        cout << "\tWhen does the exam start? (YYYY-MM-DD hh:mm:ss):\n\t";
+        get_datetime_input(&exam_time);
+        new_exam->start_time = mktime(&exam_time);
+        time(&time_now);
+        if (new_exam->start_time < time_now)
+        {
+            cout << "\t*** Error: Exam start time cannot be earlier than this moment. *** \n";
+            continue;
+        }
+        cout << "\tWhen does the exam end? (YYYY-MM-DD hh:mm:ss):\n\t";
+        get_datetime_input(&exam_time);
+        new_exam->end_time = mktime(&exam_time);
+        if (new_exam->end_time <= new_exam->start_time)
+        {
+            cout << "\t*** Error: The end time must be later than the start time! "
+                    "Try again. ***\n";
+            continue;
+        }
+        break;
+    }
+
+    generate_exam_id(new_exam);
+    strcpy(new_exam->creator_username, loggedin_user.username);
+
+    if (!save_exam(new_exam))
+    {
+        cout << "\t*** Error: Couldn't save exam data. Check read/write "
+                "permissions and disk space and then try again. ***\n";
+        wait_on_enter();
+        return -1;
+    }
+
+    cout << "\tNew exam has been successfully added!\n";
+    wait_on_enter();
+
+    // Creating the results, answers and choices files of the exam
+    create_exam_files(new_exam);
+
+    // Creating the path of exam questions file (./data/exam_[random_num]_questions.dat)
+    char exam_questions_path[MAX_CHAR_ARR_LENGTH];
+    create_examQ_path(exam_questions_path, new_exam->id);
+    FILE *exam_file = fopen(exam_questions_path, "w+");
+    Question new_question;
+
+    cout << "\tAdding the questions:\n";
+    for (int i = 0; i < new_exam->qcount; i++)
+    {
+        new_question.qnum = i + 1;
+        cout << "------------------------------------------\n";
+        cout << "\tEnter the question #" << new_question.qnum << ": ";
+        read_input(new_question.question);
+
+        char user_input;
+        while (true)
+        {
+            cout << "\tIs this question a multiple choice question? (y/n) ";
+            cin >> user_input;
+            cin.ignore();
+            if (user_input == 'n' || user_input == 'N')
+                new_question.is_multiple_choice = false;
+            else if (user_input = 'y' || user_input == 'Y')
+                new_question.is_multiple_choice = true;
+            else
+            {
+                cout << "\t*** Error: Invalid input, enter either y or n ***\n";
+                continue;
+            }
+            break;
+        }
+
+        if (new_question.is_multiple_choice)
+        {
+            cout << "\tEnter the options:\n";
+            cout << "\ta) ";
+            read_input(new_question.opt1);
+            cout << "\tb) ";
+            read_input(new_question.opt2);
+            cout << "\tc) ";
+            read_input(new_question.opt3);
+            cout << "\td) ";
+            read_input(new_question.opt4);
+            while (true)
+            {
+                cout << "\tWhich option is the correct answer? (a-d) ";
+                cin >> new_question.correct;
+                cin.ignore();
+                if (!(new_question.correct == 'a' ||
+                      new_question.correct == 'b' ||
+                      new_question.correct == 'c' ||
+                      new_question.correct == 'd'))
+                {
+                    cout << "\t*** Error: Invalid option, please enter a, b, c or d ***\n";
+                    continue;
+                }
+                break;
+            }
+        }
+
+        size_t data_written = fwrite(&new_question, sizeof(Question), 1, exam_file);
+        if (data_written)
+            cout << "\tQuestion #" << new_question.qnum << " successfully added.\n";
+        else
+        {
+            cout << "\t*** Error: Failed to save the question! "
+                    "check the write permission for files in this directory and then try again. ***\n";
+            i--;
+        }
+    }
+    fclose(exam_file);
+
+    cout << "\tExam questions successfully added.\n";
+    wait_on_enter();
+
+    return 0;
+}
+
+void take_exam()
+{
+    OperationTimer operation_timer("take_exam");
+    char exam_id[MAX_CHAR_ARR_LENGTH];
+    cout << "\tEnter the exam id you want to take: ";
+    read_input(exam_id);
+    Exam this_exam;
+    time_t time_now;
+    if (!find_exam(exam_id, &this_exam))
+    {
+        cout << "\t*** Error: No exam found with this id. ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    char user_response;
+    char log_path[2 * MAX_CHAR_ARR_LENGTH];
+    create_session_log_path(log_path, this_exam.id, loggedin_user.username);
+    cout << "\tExam found.\n";
+    while (true)
+    {
+        cout << "\tIs \"" << this_exam.name << "\" the right exam? (y/n) ";
+        read_choice(&user_response);
+        if (user_response == 'n' || user_response == 'N')
+            return;
+        else if (user_response == 'y' || user_response == 'Y')
+        {
+            // Submitting the answers of an earlier session of this exam which didn't end (if there's any)
+            if (replay_answer_log(log_path) == 1)
+            {
+                cout << "You are taking this exam on another terminal.\n";
+                wait_on_enter();
+                return;
+            }
+
+            // Checking if the user has already taken the exam or not
+            if (has_taken_exam(loggedin_user.username, this_exam.id))
+            {
+                cout << "You have already taken this exam.\n";
+                wait_on_enter();
+                return;
+            }
+            time(&time_now);
+            if (time_now >= this_exam.start_time && time_now < this_exam.end_time)
+                break;
+            else if (time_now < this_exam.start_time)
+            {
+                cout << "The exam has not started yet. It starts on ";
+                print_date(localtime(&this_exam.start_time));
+                cout << ' ';
+                print_time(localtime(&this_exam.start_time));
+                cout << '\n';
+                wait_on_enter();
+                return;
+            }
+            else
+            {
+                cout << "The exam has been ended. It was ended on ";
+                print_date(localtime(&this_exam.end_time));
+                cout << ' ';
+                print_time(localtime(&this_exam.end_time));
+                cout << '\n';
+                wait_on_enter();
+                return;
+            }
+        }
+        else
+            cout << "\tInvalid input.\n";
+        continue;
+    }
+
+    clear_console();
+    cout << this_exam.name;
+    cout << ": Loading questions...\n";
+
+    Answer user_answer;
+
+    /* Chosen options of multiple choice questions, saved as one row of the exam's choices file
+     * The answers are kept in memory until the end of the exam and then written together,
+     * so each shared file is locked only once per student
+     */
+    vector<char> user_choices(this_exam.qcount, '\0');
+    vector<Answer> essay_answers;
+
+    vector<Question> exam_questions;
+    if (!load_questions(&this_exam, &exam_questions))
+    {
+        cout << "*** Error: Could not load the questions of this exam. ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    wait_on_enter();
+
+    // The log is created once the first question is shown, leaving the exam before that doesn't count as taking it
+    AnswerLog answer_log(log_path, this_exam.id, loggedin_user.username);
+    if (!answer_log.is_open())
+    {
+        cout << "*** Error: Could not start the exam, make sure you are not taking it on another terminal. ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    time(&time_now);
+    for (size_t i = 0; i < exam_questions.size() && time_now <= this_exam.end_time; i++)
+    {
+        const Question &exam_question = exam_questions[i];
+
+        strcpy(user_answer.username, loggedin_user.username);
+        strcpy(user_answer.exam_id, this_exam.id);
+
+        time_t remaining = this_exam.end_time - time_now;
+
+        cout << "-------------------------------------------------\n";
+
+        cout << "Remaning Time: ";
+        print_time(gmtime(&remaining));
+        cout << '\n';
+
+        cout << "(" << exam_question.qnum << ") " << exam_question.question << '\n';
+        user_answer.qnum = exam_question.qnum;
+        if (exam_question.is_multiple_choice)
+        {
+            cout << "a) " << exam_question.opt1 << '\n';
+            cout << "b) " << exam_question.opt2 << '\n';
+            cout << "c) " << exam_question.opt3 << '\n';
+            cout << "d) " << exam_question.opt4 << '\n';
+            time(&time_now);
+            while (this_exam.end_time > time_now)
+            {
+                cout << "Enter your choice (a-d) or enter x for blank: ";
+                read_choice(&user_answer.chosen);
+                if (!(user_answer.chosen == 'a' ||
+                      user_answer.chosen == 'b' ||
+                      user_answer.chosen == 'c' ||
+                      user_answer.chosen == 'd' ||
+                      user_answer.chosen == 'x'))
+                {
+                    cout << "*** Error: Invalid input. Choices are: a, b, c or d or x for blank. ***\n";
+                    continue;
+                }
+                break;
+            }
+            time(&time_now);
+            if (time_now > this_exam.end_time)
+            {
+                cout << "Exam time is over! Your last answer has been saved.\n";
+                wait_on_enter();
+                break;
+            }
+            user_answer.is_multiple_choice = true;
+            time(&time_now);
+        }
+        else
+        {
+            user_answer.is_multiple_choice = false;
+            cout << "Enter your answer:\n";
+            cout << "> ";
+            read_input(user_answer.essay_answer);
+            time(&time_now);
+            if (time_now > this_exam.end_time)
+            {
+                cout << "Exam time has ended!\n";
+                wait_on_enter();
+                break;
+            }
+        }
+        if (user_answer.is_multiple_choice)
+        {
+            if (user_answer.qnum >= 1 && user_answer.qnum <= this_exam.qcount)
+                user_choices[user_answer.qnum - 1] = user_answer.chosen;
+        }
+        else
+            essay_answers.push_back(user_answer);
+        answer_log.append(&user_answer);
+        time(&time_now);
+    }
+    answer_log.commit();
+
+    // Saving and grading the answers (by the EMS server if this process is connected to one)
+    int submit_status;
+    if (!server_submit_exam(&this_exam, user_choices.data(), essay_answers, &submit_status))
+    {
+        submit_status = submit_exam(&this_exam, loggedin_user.username, user_choices.data(), essay_answers.data(),
+                                    essay_answers.size());
+    }
+    if (submit_status == -1)
+    {
+        // The answers stay in the answer log, they're submitted on the next startup of EMS
+        cout << "*** Error: Could not save your answers, the exam files are not accessible. ***\n";
+        wait_on_enter();
+        return;
+    }
+    answer_log.discard();
+    if (submit_status == 1)
+    {
+        cout << "You have already taken this exam.\n";
+        wait_on_enter();
+        return;
+    }
+
+    cout << "Exam compeleted.\n";
+    wait_on_enter();
+}
+
+void correct_answer_key()
+{
+    char exam_id[MAX_CHAR_ARR_LENGTH];
+    Exam exam_tmp;
+    unsigned int qnum;
+    char new_correct;
+
+    cout << "\tEnter the Exam ID: ";
+    read_input(exam_id);
+    if (!find_exam(exam_id, &exam_tmp))
+    {
+        cout << "\t*** Error: No exam found with this ID ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Only the creator of the exam can change its answer key
+    if (strcmp(exam_tmp.creator_username, loggedin_user.username) != 0)
+    {
+        cout << "\t*** Error: You cannot change the answer key of this exam, because you're not the creator of it. ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    cout << "\tEnter the question number: ";
+    cin >> qnum;
+    cin.ignore();
+    while (true)
+    {
+        cout << "\tWhich option is the correct answer? (a-d) ";
+        cin >> new_correct;
+        cin.ignore();
+        if (!(new_correct == 'a' || new_correct == 'b' || new_correct == 'c' || new_correct == 'd'))
+        {
+            cout << "\t*** Error: Invalid option, please enter a, b, c or d ***\n";
+            continue;
+        }
+        break;
+    }
+
+    int updated_count = change_answer_key(exam_tmp.id, qnum, new_correct);
+    if (updated_count == -1)
+        cout << "\t*** Error: Question #" << qnum << " is not a multiple choice question of this exam, "
+                "or the exam files couldn't be saved. ***\n";
+    else
+        cout << "\tThe answer key has been changed, " << updated_count << " results were regraded.\n";
+    wait_on_enter();
+}
+
+void show_exam_results_P()
+{
+    char exam_id_to_look_for[MAX_CHAR_ARR_LENGTH];
+
+    Exam exam_tmp;
+
+    time_t time_now;
+
+    cout << "\tEnter the Exam ID you want to see the results of: ";
+    read_input(exam_id_to_look_for);
+
+    if (!find_exam(exam_id_to_look_for, &exam_tmp))
+    {
+        cout << "\t*** Error: No exam found with this ID ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Checking if the exam creator is the same user as the loggedin professor
+    if (strcmp(exam_tmp.creator_username, loggedin_user.username) != 0)
+    {
+        cout << "\t*** Error: You cannot see the results of this exam, because you're not the creator of it. ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Checking if the exam is over
+    time(&time_now);
+    if (time_now < exam_tmp.end_time)
+    {
+        cout << "\t*** Error: The exam is not over yet, wait until ";
+        print_date(localtime(&exam_tmp.end_time));
+        cout << ' ';
+        print_time(localtime(&exam_tmp.end_time));
+        cout << " ***\n";
+        wait_on_enter();
+        return;
+    }
+    print_exam_results(&exam_tmp);
+}
+
+void print_exam_results(const Exam *exam)
+{
+    OperationTimer operation_timer("exam_results_professor");
+    // Shows the results report of an exam, with the essay answers of each student
+    char exam_answer_path[MAX_CHAR_ARR_LENGTH]; // Will be the path for exam's Answer structs
+    char exam_result_path[MAX_CHAR_ARR_LENGTH]; // Will be the path for exam's Result structs
+    const Exam &exam_tmp = *exam;
+
+    clear_console();
+    // Exam details, shown on top of every page of the report
+    string header;
+    header += "Exam Name | Exam ID | Started on | Ended on | Question count\n";
+    header += "------------------------------------------------------------\n";
+    header += exam_tmp.name;
+    header += " | ";
+    header += exam_tmp.id;
+    header += " | ";
+    append_datetime(&header, exam_tmp.start_time);
+    header += " | ";
+    append_datetime(&header, exam_tmp.end_time);
+    header += " | ";
+    header += to_string(exam_tmp.qcount);
+    header += '\n';
+
+    create_examR_path(exam_result_path, exam_tmp.id);
+    RecordFile<Result> exam_result_file(exam_result_path);
+
+    create_examA_path(exam_answer_path, exam_tmp.id);
+    AnswerReader exam_answer_file(exam_answer_path);
+
+    /* Reading the answers file once and grouping the essay answers by username
+     * essays_by_username maps a username to the positions of their essay answers in the answers file
+     */
+    unordered_map<string, vector<size_t> > essays_by_username;
+    AnswerRecord student_answer;
+    size_t answer_position = exam_answer_file.tell();
+    while (exam_answer_file.next(&student_answer))
+    {
+        if (!student_answer.is_multiple_choice)
+            essays_by_username[student_answer.username].push_back(answer_position);
+        answer_position = exam_answer_file.tell();
+    }
+
+    // Loading users registered since the last sync once for the whole report
+    sync_users_index();
+
+    header += "\tStudent full name | Student username | Correct | Wrong | Total multiple choice | Percentage\n";
+    header += "\t-------------------------------------------------------------------------------------------\n";
+    show_pages(header, exam_result_file.size(), [&](size_t row, string *buffer) {
+        const Result &student_result = exam_result_file[row];
+        char percent_text[32];
+        snprintf(percent_text, sizeof(percent_text), "%g", student_result.multiple_choice_percent);
+
+        *buffer += '\t';
+        append_fullname_of_username(buffer, student_result.username);
+        *buffer += " | ";
+        *buffer += student_result.username;
+        *buffer += " | ";
+        *buffer += to_string(student_result.correct_choices_count);
+        *buffer += " | ";
+        *buffer += to_string(student_result.wrong_choices_count);
+        *buffer += " | ";
+        *buffer += to_string(student_result.multiple_choice_count);
+        *buffer += " | ";
+        *buffer += percent_text;
+        *buffer += '\n';
+
+        // Essay question answers
+        unordered_map<string, vector<size_t> >::iterator essays = essays_by_username.find(student_result.username);
+        if (essays != essays_by_username.end())
+        {
+            for (size_t i = 0; i < essays->second.size(); i++)
+            {
+                exam_answer_file.seek(essays->second[i]);
+                exam_answer_file.next(&student_answer);
+                *buffer += "\tQuestion #";
+                *buffer += to_string(student_answer.qnum);
+                *buffer += ":  ";
+                *buffer += student_answer.essay_answer;
+                *buffer += '\n';
+            }
+        }
+
+        *buffer += "\t-------------------------------------------------------------------------------------------\n";
+    });
+
+    cout << '\n';
+    wait_on_enter();
+}
+
+void show_exam_results_S()
+{
+    OperationTimer operation_timer("exam_results_student");
+    char exam_result_path[MAX_CHAR_ARR_LENGTH];
+    char exam_answer_path[MAX_CHAR_ARR_LENGTH];
+
+    time_t time_now;
+
+    char exam_id[MAX_CHAR_ARR_LENGTH];
+    cout << "\tEnter the Exam ID you want to see the results of: ";
+    read_input(exam_id);
+
+    // Checking if the student has taken this exam or not
+    if (!has_taken_exam(loggedin_user.username, exam_id))
+    {
+        cout << "\t*** Error: You have not taken any exam with this ID ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Creating results file path for the found exam
+    create_examR_path(exam_result_path, exam_id);
+    RecordFile<Result> exam_result_file(exam_result_path);
+
+    // Creating answer file path for the found exam
+    create_examA_path(exam_answer_path, exam_id);
+    AnswerReader exam_answer_file(exam_answer_path);
+
+    for (size_t i = 0; i < exam_result_file.size(); i++)
+    {
+        const Result &student_result = exam_result_file[i];
+        if (strcmp(student_result.username, loggedin_user.username) == 0)
+        {
+            // Checking if the time has come to show the results
+            time(&time_now);
+            if (time_now < student_result.visible_time)
+            {
+                cout << "\t*** Error: You cannot see the results right now, wait until the exam is over ***\n";
+                cout << "\tThe results will be available on ";
+                print_date(localtime(&student_result.visible_time));
+                cout << ' ';
+                print_time(localtime(&student_result.visible_time));
+                cout << '\n';
+
+                wait_on_enter();
+                return;
+            }
+
+            // Showing exam result with the ID of exam_id
+            cout << "Name | Exam ID | Correct | Wrong | Total Multiple Choice | Percentage\n";
+            cout << "---------------------------------------------------------------------\n";
+
+            cout << student_result.exam_name << " | ";
+            cout << student_result.exam_id << " | ";
+            cout << student_result.correct_choices_count << " | ";
+            cout << student_result.wrong_choices_count << " | ";
+            cout << student_result.multiple_choice_count << " | ";
+            cout << student_result.multiple_choice_percent << '\n';
+
+            // Printing essay question answers
+            AnswerRecord student_answer;
+            while (exam_answer_file.next(&student_answer))
+            {
+                if (strcmp(student_answer.username, loggedin_user.username) == 0 && !student_answer.is_multiple_choice)
+                {
+                    cout << "\tQuestion #" << student_answer.qnum;
+                    cout << ":  " << student_answer.essay_answer;
+                    cout << '\n';
+                }
+            }
+            cout << "---------------------------------------------------------------------\n";
+
+            break;
+        }
+    }
+
+    cout << '\n';
+    wait_on_enter();
+}
+
+void show_exam_answers()
+{
+    OperationTimer operation_timer("exam_answers");
+    char exam_id_to_show_answers[MAX_CHAR_ARR_LENGTH];
+    char username_to_show_answers[MAX_CHAR_ARR_LENGTH];
+    Exam exam_tmp;
+
+    char exam_answer_path[MAX_CHAR_ARR_LENGTH];
+    char exam_choices_path[MAX_CHAR_ARR_LENGTH];
+    char exam_question_path[MAX_CHAR_ARR_LENGTH];
+
+    time_t time_now;
+
+    cout << "\tEnter the Exam ID: ";
+    read_input(exam_id_to_show_answers);
+
+    if (!find_exam(exam_id_to_show_answers, &exam_tmp))
+    {
+        cout << "\t*** Error: No exam found with this id ***\n";
+
+        wait_on_enter();
+        return;
+    }
+
+    // Checking if the professor has permission to access the answers
+    if (loggedin_user.role == 'P' && strcmp(exam_tmp.creator_username, loggedin_user.username) != 0)
+    {
+        cout << "\t*** Error: You do not have permission to see the answers of this exam ***\n";
+        cout << "\tYou can only see the answers of an exam that you created yourself\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Checking if the student has taken this exam or not
+    if (loggedin_user.role == 'S' && !has_taken_exam(loggedin_user.username, exam_tmp.id))
+    {
+        cout << "\t*** Error: You have not taken any exam with this ID ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    // Checking if the time to show answers has come
+    time(&time_now);
+    if (time_now < exam_tmp.end_time)
+    {
+        cout << "\t*** Error: The exam is not over yet, wait until ";
+        print_date(localtime(&exam_tmp.end_time));
+        cout << ' ';
+        print_time(localtime(&exam_tmp.end_time));
+        cout << " ***\n";
+        wait_on_enter();
+        return;
+    }
+
+    clear_console();
+
+    create_examQ_path(exam_question_path, exam_tmp.id);
+    RecordFile<Question> exam_question_file(exam_question_path);
+
+    // Loading users registered since the last sync once for the whole report
+    sync_users_index();
+
+    /* Multiple choice answers are in the choices file and essay answers are in the answers file
+     * (the answers file also has the multiple choice answers of exams taken before it was migrated)
+     */
+    create_examC_path(exam_choices_path, exam_tmp.id);
+    ChoiceMatrix exam_choices_file(exam_choices_path);
+    create_examA_path(exam_answer_path, exam_tmp.id);
+    AnswerReader exam_answer_file(exam_answer_path);
+
+    /* Grouping the answers by student
+     * students holds the usernames in the order they are printed, student_choices maps a username
+     * to the student's row of choices and answers_by_username to the positions of their answers in the answers file
+     */
+    vector<string> students;
+    unordered_map<string, const char *> student_choices;
+    unordered_map<string, vector<size_t> > answers_by_username;
+    for (size_t i = 0; i < exam_choices_file.size(); i++)
+    {
+        if (exam_choices_file.user_num(i) >= users_table.size()) continue;
+        const char *username = users_table[exam_choices_file.user_num(i)].username;
+        if (loggedin_user.role == 'S' && strcmp(username, loggedin_user.username) != 0)
+            continue;
+        if (student_choices.insert(make_pair(string(username), exam_choices_file.choices(i))).second)
+            students.push_back(username);
+    }
+    AnswerRecord answer_tmp;
+    size_t answer_position = exam_answer_file.tell();
+    while (exam_answer_file.next(&answer_tmp))
+    {
+        if (loggedin_user.role != 'S' || strcmp(answer_tmp.username, loggedin_user.username) == 0)
+        {
+            vector<size_t> &positions = answers_by_username[answer_tmp.username];
+            if (positions.empty() && student_choices.find(answer_tmp.username) == student_choices.end())
+                students.push_back(answer_tmp.username);
+            positions.push_back(answer_position);
+        }
+        answer_position = exam_answer_file.tell();
+    }
+
+    /* The rows of the report are the questions followed by the students
+     * a student's row has all the answers of the student
+     */
+    size_t question_count = exam_question_file.size();
+    show_pages("", question_count + students.size(), [&](size_t row, string *buffer) {
+        if (row < question_count)
+        {
+            const Question &question_tmp = exam_question_file[row];
+            if (row == 0) *buffer += "Exam questions:\n";
+            *buffer += "Question #";
+            *buffer += to_string(question_tmp.qnum);
+            *buffer += ": ";
+            *buffer += question_tmp.question;
+            *buffer += "\n\ta) ";
+            *buffer += question_tmp.opt1;
+            *buffer += "\tb) ";
+            *buffer += question_tmp.opt2;
+            *buffer += "\tc) ";
+            *buffer += question_tmp.opt3;
+            *buffer += "\td) ";
+            *buffer += question_tmp.opt4;
+            *buffer += "\n\tCorrect choice: ";
+            *buffer += question_tmp.correct;
+            *buffer += "\n--------------------------------------------------------------\n";
+            return;
+        }
+
+        if (row == question_count) *buffer += "\nAnswers:\n";
+        const string &student = students[row - question_count];
+        unordered_map<string, const char *>::iterator choices = student_choices.find(student);
+        vector<size_t> &positions = answers_by_username[student];
+        size_t next_answer = 0;
+
+        // The answers of the student in the order of question numbers
+        for (unsigned int qnum = 1; qnum <= exam_tmp.qcount; qnum++)
+        {
+            if (choices != student_choices.end() && qnum <= exam_choices_file.question_count() &&
+                choices->second[qnum - 1] != '\0')
+            {
+                answer_tmp.qnum = qnum;
+                answer_tmp.is_multiple_choice = true;
+                answer_tmp.chosen = choices->second[qnum - 1];
+                answer_tmp.username = choices->first.c_str();
+                answer_tmp.essay_answer = "";
+                append_answer(buffer, &answer_tmp);
+            }
+            while (next_answer < positions.size())
+            {
+                exam_answer_file.seek(positions[next_answer]);
+                exam_answer_file.next(&answer_tmp);
+                if (answer_tmp.qnum != qnum) break;
+                append_answer(buffer, &answer_tmp);
+                next_answer++;
+            }
+        }
+        // Answers with question numbers out of range, if any
+        for (; next_answer < positions.size(); next_answer++)
+        {
+            exam_answer_file.seek(positions[next_answer]);
+            exam_answer_file.next(&answer_tmp);
+            append_answer(buffer, &answer_tmp);
+        }
+    });
+
+    cout << '\n';
+    wait_on_enter();
+}
+
+void get_datetime_input(tm *datetime)
+{
+    // Gets date and time in YYYY-MM-DD hh:mm:ss format
+    while (true)
+    {
+        cin.sync();
+        // cin.ignore(INT_MAX);
+        cin >> datetime->tm_year;
+        datetime->tm_year -= 1900; // Substracting 1900 because tm::tm_year holds (Year-1900)
+        if (cin.get() != '-')
+        {
+            cout << "\t*** Error: Invalid date format, make sure to enter date as "
+                    "YYYY-MM-DD. Try agian. ***\n\t";
+            continue;
+        }
+        cin >> datetime->tm_mon;
+        datetime->tm_mon -= 1; // Substracting 1 because tm::tm_mon starts from
+                               // 0 (Jan:0, Feb:1, ..., Dec: 11)
+        if (cin.get() != '-')
+        {
+            cout << "\t*** Error: Invalid date format, make sure to enter date as "
+                    "YYYY-MM-DD. Try agian. ***\n\t";
+            continue;
+        }
+        cin >> datetime->tm_mday;
+        if (cin.get() != ' ')
+        {
+            cout << "\t*** Error: Invalid date format, make sure to enter date as "
+                    "YYYY-MM-DD. Try agian. ***\n\t";
+            continue;
+        }
+        cin >> datetime->tm_hour;
+        if (cin.get() != ':')
+        {
+            cout << "\t*** Error: Invalid date format, make sure to enter date as "
+                    "hh:mm:ss. Try agian. ***\n\t";
+            continue;
+        }
+        cin >> datetime->tm_min;
+        if (cin.get() != ':')
+        {
+            cout << "\t*** Error: Invalid date format, make sure to enter date as "
+                    "hh:mm:ss. Try agian. ***\n\t";
+            continue;
+        }
+        cin >> datetime->tm_sec;
+        cin.ignore();
+        datetime->tm_isdst = -1;
+        break;
+    }
+}
+
+bool validate_password(char *pass, char *pass_repeat)
+{
+    if (strcmp(pass, pass_repeat) != 0)
+    {
+        cout << "\t*** Error: Passwords do not match. ***\n";
+        return false;
+    }
+
+    // Password length must be longer that 8 characters
+    unsigned int count = 0;
+    while (pass[count] != '\0')
+        count++;
+    if (count < 8)
+    {
+        cout << "\t*** Error: Password must be longer than 8 characters. ***\n";
+        return false;
+    }
+
+    return true;
+}
+
+void show_pages(const string &header, size_t row_count, const function<void(size_t, string *)> &render_row)
+{
+    /* Shows a listing page by page, the header is shown on top of every page
+     * render_row appends the text of a row to the page buffer. Only the rows of the shown page are rendered,
+     * into one buffer which is reused for every page, and the page is written at once instead of field by field.
+     * If there is more than one page, the user can go to the next or previous page, jump to a page or quit.
+     */
+    size_t page_count = (row_count + LIST_PAGE_SIZE - 1) / LIST_PAGE_SIZE;
+    size_t page = 0;
+    string page_buffer;
+    char user_response[MAX_CHAR_ARR_LENGTH];
+    while (true)
+    {
+        page_buffer.clear();
+        page_buffer += header;
+        for (size_t row = page * LIST_PAGE_SIZE; row < row_count && row < (page + 1) * LIST_PAGE_SIZE; row++)
+            render_row(row, &page_buffer);
+        cout.write(page_buffer.data(), page_buffer.size());
+        cout.flush();
+        metric_counters.output_bytes += page_buffer.size();
+
+        if (page_count <= 1) return;
+
+        // Asking until the user chooses another page or quits
+        size_t next_page = page;
+        while (next_page == page)
+        {
+            cout << "\tPage " << page + 1 << " of " << page_count << ". (n)ext, (p)revious, page number or (q)uit: ";
+            read_input(user_response);
+            if (feof(stdin) || user_response[0] == 'q' || user_response[0] == 'Q')
+                return;
+            else if (user_response[0] == '\0' || user_response[0] == 'n' || user_response[0] == 'N')
+            {
+                if (page + 1 == page_count) return;
+                next_page = page + 1;
+            }
+            else if ((user_response[0] == 'p' || user_response[0] == 'P') && page > 0)
+                next_page = page - 1;
+            else
+            {
+                unsigned long page_number = strtoul(user_response, NULL, 10);
+                if (page_number >= 1 && page_number <= page_count)
+                    next_page = page_number - 1;
+            }
+        }
+        page = next_page;
+        clear_console();
+    }
+}
+
+void list_all_users(char user_role)
+{
+    OperationTimer operation_timer("list_users");
+    // Users are listed in the order of the users by last name index, so they don't need to be sorted
+    vector<unsigned int> sorted_users;
+    load_users_by_lname(&sorted_users);
+    vector<unsigned int> role_users;
+    for (size_t i = 0; i < sorted_users.size(); i++)
+    {
+        if (sorted_users[i] < users_table.size() && users_table[sorted_users[i]].role == user_role)
+            role_users.push_back(sorted_users[i]);
+    }
+
+    if (role_users.empty())
+    {
+        cout << "\tNo users found.\n";
+    }
+    else
+    {
+        show_pages("First name | Last name (sorted) | Username\n"
+                   "------------------------------------------\n",
+                   role_users.size(), [&](size_t row, string *buffer) {
+                       const User &user = users_table[role_users[row]];
+                       *buffer += user.fname;
+                       *buffer += " | ";
+                       *buffer += user.lname;
+                       *buffer += " | ";
+                       *buffer += user.username;
+                       *buffer += "\n------------------------------------------\n";
+                   });
+    }
+    cout << '\n';
+    wait_on_enter();
+}
+
+void list_all_exams()
+{
+    OperationTimer operation_timer("list_exams");
+    // Exams are listed in the order of the exams by start time index, only the exams of the shown pages are read
+    vector<ExamStartEntry> sorted_entries;
+    load_exams_by_start(&sorted_entries);
+    RecordFile<Exam> exam_file("./data/exams.dat");
+    size_t exam_count = sorted_entries.size();
+    if (exam_count == 0)
+        cout << "\tNo exams found.\n";
+    else
+    {
+        string header;
+        if (loggedin_user.role == 'P')
+            header += "Created by me | ";
+        header += "Exam name | State | Start time (sorted) | End time | Duration | ID\n"
+                  "------------------------------------------------------------------\n";
+
+        time_t time_now;
+        time(&time_now);
+        show_pages(header, exam_count, [&](size_t row, string *buffer) {
+            if (sorted_entries[row].record_num >= exam_file.size()) return;
+            const Exam &exam = exam_file[sorted_entries[row].record_num];
+
+            /*
+             * Printing asterisk (*) if exam is created by the loggedin user
+             * otherwise printing blank ([space])
+            */
+            if (loggedin_user.role == 'P')
+                *buffer += strcmp(exam.creator_username, loggedin_user.username) == 0 ? "* | " : "  | ";
+
+            // Name
+            *buffer += exam.name;
+            *buffer += " | ";
+            // State
+            if (exam.start_time > time_now)
+                *buffer += "Not started yet";
+            else if (exam.end_time < time_now)
+                *buffer += "Has been ended";
+            else
+                *buffer += "Currently ongoing...";
+            *buffer += " | ";
+            // Start date and time
+            append_datetime(buffer, exam.start_time);
+            *buffer += " | ";
+            // End date and time
+            append_datetime(buffer, exam.end_time);
+            *buffer += " | ";
+            // Duration
+            append_duration(buffer, exam.end_time - exam.start_time);
+            *buffer += " | ";
+            // ID
+            *buffer += exam.id;
+            *buffer += "\n------------------------------------------------------------------\n";
+        });
+    }
+
+    cout << '\n';
+    wait_on_enter();
+}
+
+void read_input(char *var)
+{
+    // Reads input and then replaces '\n' character with '\0'
+    InputTimer input_timer;
+    if (fgets(var, MAX_CHAR_ARR_LENGTH - 2, stdin) == NULL) var[0] = '\0';
+    for (int i = 0; i < MAX_CHAR_ARR_LENGTH; i++)
+    {
+        if (var[i] == '\n')
+        {
+            var[i] = '\0';
+            break;
+        }
+    }
+}
+
+bool input_ended()
+{
+    // true if nothing more can be read, read_input() reads with stdio and the rest of the console with cin
+    return feof(stdin) || cin.eof() || cin.fail();
+}
+
+void read_choice(char *choice)
+{
+    // Reads a single character answer and skips the rest of the line
+    InputTimer input_timer;
+    cin >> *choice;
+    cin.ignore();
+}
+
+void init_console()
+{
+    // Windows consoles handle ANSI escape sequences only when virtual terminal processing is enabled
+#ifdef _WIN32
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode;
+    console_escapes = GetConsoleMode(console, &mode) && SetConsoleMode(console, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+#endif
+}
+
+void clear_console()
+{
+    // Moving the cursor to the top left and erasing the screen with ANSI escape sequences, instead of running "clear"
+#ifdef _WIN32
+    // Consoles without escape sequences are cleared with the console API, instead of running "cls"
+    if (!console_escapes)
+    {
+        cout.flush();
+        HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+        CONSOLE_SCREEN_BUFFER_INFO screen;
+        COORD top_left = {0, 0};
+        DWORD written;
+        if (GetConsoleScreenBufferInfo(console, &screen))
+        {
+            DWORD cell_count = (DWORD)screen.dwSize.X * screen.dwSize.Y;
+            FillConsoleOutputCharacterA(console, ' ', cell_count, top_left, &written);
+            FillConsoleOutputAttribute(console, screen.wAttributes, cell_count, top_left, &written);
+            SetConsoleCursorPosition(console, top_left);
+        }
+        return;
+    }
+#endif
+    cout << "\033[1;1H\033[2J" << flush;
+}
+
+void wait_on_enter()
+{
+    InputTimer input_timer;
+    cout << "> Press enter to continue...";
+    cin.get();
+    cin.sync();
+}
+
+void print_date(tm *date)
+{
+    // Prints date in YYYY-MM-DD format
+    // YYYY-
+    cout << date->tm_year + 1900 << '-';
+    // MM-
+    if (date->tm_mon + 1 < 10) cout << '0';
+    cout << date->tm_mon + 1 << '-';
+    // DD
+    if (date->tm_mday < 10) cout << '0';
+    cout << date->tm_mday;
+}
+
+void print_time(tm *time)
+{
+    // Prints time in hh:mm:ss format
+    if (time->tm_hour < 10) cout << '0';
+    cout << time->tm_hour << ':';
+    // mm:
+    if (time->tm_min < 10) cout << '0';
+    cout << time->tm_min << ':';
+    // ss
+    if (time->tm_sec < 10) cout << '0';
+    cout << time->tm_sec;
+}
+
+void append_datetime(string *buffer, time_t datetime)
+{
+    // Appends the local date and time in YYYY-MM-DD hh:mm:ss format, converting the time only once
+    char datetime_text[32];
+    tm *local_datetime = localtime(&datetime);
+    if (local_datetime == NULL || strftime(datetime_text, sizeof(datetime_text), "%Y-%m-%d %H:%M:%S", local_datetime) == 0)
+        strcpy(datetime_text, "Undefined");
+    *buffer += datetime_text;
+}
+
+void append_duration(string *buffer, time_t duration)
+{
+    // Appends a duration in hh:mm:ss format
+    char duration_text[32];
+    snprintf(duration_text, sizeof(duration_text), "%02d:%02d:%02d",
+             (int)(duration / 3600 % 24), (int)(duration / 60 % 60), (int)(duration % 60));
+    *buffer += duration_text;
+}
+
+void append_fullname_of_username(string *buffer, const char *username)
+{
+    /* Reports call this once per row, so it never reads users.dat itself
+     * The report must call sync_users_index() once before rendering its rows
+     */
+    const User *user = lookup_user(username);
+    if (user != NULL)
+    {
+        *buffer += user->fname;
+        *buffer += ' ';
+        *buffer += user->lname;
+    }
+    else
+        *buffer += "Undefined";
+}
+
+void append_answer(string *buffer, const AnswerRecord *answer)
+{
+    *buffer += "Full Name: ";
+    append_fullname_of_username(buffer, answer->username);
+    *buffer += " | ";
+    *buffer += "Username: ";
+    *buffer += answer->username;
+    *buffer += '\n';
+
+    *buffer += "\tanswered question #";
+    *buffer += to_string(answer->qnum);
+    *buffer += ": ";
+    if (answer->is_multiple_choice)
+        if (answer->chosen == 'x')
+            *buffer += "[blank]";
+        else
+            *buffer += answer->chosen;
+    else
+    {
+        *buffer += "\n\t";
+        *buffer += answer->essay_answer;
+    }
+
+    *buffer += "\n--------------------------------------------------------------\n";
+}
+
+bool logout(User loggedin_user)
+{
+    // Returns true if the user is sure to quit
+    clear_console();
+    char user_response;
+    cout << "Are you sure you want yo quit? (y/n) ";
+    cin >> user_response;
+    cin.ignore();
+    if (user_response == 'y' || user_response == 'Y')
+    {
+        cout << "#### Thank you for using EMS ####\n";
+        cout << "Bye " << loggedin_user.fname << "! :)\n";
+        return true;
+    }
+    return false;
+}
+
+void append_json_string(string *buffer, const char *text)
+{
+    // Appends text as a quoted JSON string
+    *buffer += '"';
+    for (; *text != '\0'; text++)
+    {
+        unsigned char c = *text;
+        if (c == '"' || c == '\\')
+        {
+            *buffer += '\\';
+            *buffer += c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            *buffer += escaped;
+        }
+        else
+            *buffer += c;
+    }
+    *buffer += '"';
+}
+
+void record_metrics(const char *operation, const MetricCounters &counters, double wall_us)
+{
+    /* Appends the metrics of an operation to METRICS_PATH as a line of JSON
+     * The file stays open for the rest of the program and every line is flushed, so the file is complete
+     * even if the program is killed. Nothing is recorded if EMS_METRICS is 0 or the file can't be opened.
+     */
+    static FILE *metrics_file = NULL;
+    static bool disabled = false;
+    if (disabled) return;
+    if (metrics_file == NULL)
+    {
+        const char *setting = getenv("EMS_METRICS");
+        if (setting != NULL && strcmp(setting, "0") == 0)
+            metrics_file = NULL;
+        else
+            metrics_file = fopen(METRICS_PATH, "a");
+        if (metrics_file == NULL)
+        {
+            disabled = true;
+            return;
+        }
+    }
+
+    string line = "{\"time\": " + to_string((long long)time(NULL)) + ", \"operation\": ";
+    append_json_string(&line, operation);
+    line += ", \"user\": ";
+    append_json_string(&line, loggedin_user.username);
+    char numbers[256];
+    snprintf(numbers, sizeof(numbers),
+             ", \"wall_us\": %.1f, \"input_wait_us\": %.1f, \"file_opens\": %llu, \"records_mapped\": %llu, "
+             "\"bytes_mapped\": %llu, \"output_bytes\": %llu}\n",
+             wall_us, counters.input_wait_us, counters.file_opens, counters.records_mapped, counters.bytes_mapped,
+             counters.output_bytes);
+    line += numbers;
+    fwrite(line.data(), 1, line.size(), metrics_file);
+    fflush(metrics_file);
+}
+
+OperationTimer::OperationTimer(const char *operation)
+    : operation(operation), cancelled(false), start_counters(metric_counters), start_time(chrono::steady_clock::now())
+{
+}
+
+OperationTimer::~OperationTimer()
+{
+    if (cancelled) return;
+    double wall_us = chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+    MetricCounters counters;
+    counters.file_opens = metric_counters.file_opens - start_counters.file_opens;
+    counters.records_mapped = metric_counters.records_mapped - start_counters.records_mapped;
+    counters.bytes_mapped = metric_counters.bytes_mapped - start_counters.bytes_mapped;
+    counters.output_bytes = metric_counters.output_bytes - start_counters.output_bytes;
+    counters.input_wait_us = metric_counters.input_wait_us - start_counters.input_wait_us;
+    record_metrics(operation, counters, wall_us);
+}
+
+InputTimer::~InputTimer()
+{
+    metric_counters.input_wait_us += chrono::duration<double, micro>(chrono::steady_clock::now() - start_time).count();
+}
@@ -0,0 +1,104 @@
+/* EMS console UI
+ * The login screen, the menus of the manager, professors and students and the reports and listings,
+ * reading the user's input from the console. The data is read and saved with the storage engine (storage.h).
+ */
+#ifndef EMS_CONSOLE_H
+#define EMS_CONSOLE_H
+
+#include "storage.h"
+
+#include <functional>
+
+// The user who has logged in on the login screen
+extern User loggedin_user;
+
+// Number of rows shown at once by the listings and reports
+const unsigned int LIST_PAGE_SIZE = 50;
+
+/* Metrics of the user facing operations (logging in, taking an exam, the reports and the listings)
+ * RecordFile and the input and output functions add to metric_counters. An OperationTimer takes the
+ * counters at the start and end of an operation and appends the difference and the wall time to METRICS_PATH,
+ * one JSON object per line:
+ * {"time": 1650000000, "operation": "list_exams", "user": "prof", "wall_us": 1520.3, "input_wait_us": 1210.8,
+ *  "file_opens": 3, "records_mapped": 240, "bytes_mapped": 196320, "output_bytes": 6100}
+ * wall_us - input_wait_us is the time EMS itself took. Setting EMS_METRICS=0 turns the metrics file off.
+ */
+const char METRICS_PATH[] = "./data/metrics.jsonl";
+
+// Records the metrics of an operation from its construction to its destruction
+class OperationTimer
+{
+public:
+    OperationTimer(const char *operation);
+    ~OperationTimer();
+    // Records nothing for the operation (e.g. the input ended before the operation was done)
+    void cancel() { cancelled = true; }
+
+private:
+    const char *operation;
+    bool cancelled;
+    MetricCounters start_counters;
+    std::chrono::steady_clock::time_point start_time;
+};
+
+// Adds the time from its construction to its destruction to metric_counters.input_wait_us
+class InputTimer
+{
+public:
+    InputTimer() : start_time(std::chrono::steady_clock::now()) {}
+    ~InputTimer();
+
+private:
+    std::chrono::steady_clock::time_point start_time;
+};
+
+/* States of the main menu loop (show_main_menu())
+ * Each role has its own menu state, a menu shows its options once, runs the chosen one and returns the next state
+ */
+enum MenuState
+{
+    MENU_MANAGER,
+    MENU_PROFESSOR,
+    MENU_STUDENT,
+    // The user has logged out (or the input has ended)
+    MENU_EXIT
+};
+
+void on_startup();
+void setup();
+void show_main_menu();
+MenuState show_manager_menu();
+MenuState show_professor_menu();
+MenuState show_student_menu();
+int register_user(User *user);
+int add_exam(Exam *exam);
+void take_exam();
+void correct_answer_key();
+void show_exam_results_P();
+void print_exam_results(const Exam *exam);
+void show_exam_results_S();
+void show_exam_answers();
+void get_datetime_input(tm *datetime);
+void welcome_user(User *user);
+bool login_screen();
+bool validate_password(char *pass, char *pass_repeat);
+void show_pages(const std::string &header, size_t row_count, const std::function<void(size_t, std::string *)> &render_row);
+void list_all_users(char user_role);
+void list_all_exams();
+void read_input(char *var);
+bool input_ended();
+void read_choice(char *choice);
+void init_console();
+void clear_console();
+void wait_on_enter();
+void print_date(tm *timedate);
+void print_time(tm *timedate);
+void append_datetime(std::string *buffer, time_t datetime);
+void append_duration(std::string *buffer, time_t duration);
+void append_fullname_of_username(std::string *buffer, const char *username);
+void append_answer(std::string *buffer, const AnswerRecord *answer);
+bool logout(User loggedin_user);
+void append_json_string(std::string *buffer, const char *text);
+void record_metrics(const char *operation, const MetricCounters &counters, double wall_us);
+
+#endif
@@ -0,0 +1,62 @@
+#!/bin/bash
+# Scripted exam workload used for profile-guided optimization ("make pgo")
+# usage: pgo_train.sh <ems binary> <work directory>
+# Imports 100 students and 2 exams, lets the students take the exams (once through the data files and
+# once through "ems serve"), then shows the listings and reports and exports and regrades the results.
+set -e
+EMS=$(realpath "$1")
+rm -rf "$2"
+mkdir -p "$2"
+cd "$2"
+STUDENTS=100
+
+# First startup: registering the manager
+printf 'Admin\nBoss\nadmin\npassword123\npassword123\n\nadmin\npassword123\n\n5\ny\n' | "$EMS" > /dev/null
+
+{
+    echo "role,first name,last name,username,password"
+    echo "P,Pat,Professor,prof,password123"
+    for i in $(seq 1 $STUDENTS); do
+        echo "S,student$i,lastname$((i * 37 % STUDENTS)),student$i,password$i"
+    done
+} > users.csv
+"$EMS" import-users users.csv > /dev/null
+
+# Two ongoing exams with 8 multiple choice and 2 essay questions, both end a few seconds after the students finish
+START=$(date -d '-1 minute' '+%Y-%m-%d %H:%M:%S')
+END_SECONDS=$(($(date +%s) + 20))
+END=$(date -d "@$END_SECONDS" '+%Y-%m-%d %H:%M:%S')
+write_exam() {
+    echo "{\"name\": \"$1\", \"creator\": \"prof\", \"start\": \"$START\", \"end\": \"$END\", \"questions\": ["
+    for q in 1 2 3 4 5 6 7 8; do
+        echo "{\"question\": \"Question $q\", \"options\": [\"one\", \"two\", \"three\", \"four\"], \"correct\": \"b\"},"
+    done
+    echo "{\"question\": \"Explain the first answer\"}, {\"question\": \"Explain the second answer\"}]}"
+}
+write_exam "Training exam 1" > exam1.json
+write_exam "Training exam 2" > exam2.json
+EXAM1=$("$EMS" import-exam exam1.json | grep -o '[0-9]*$')
+EXAM2=$("$EMS" import-exam exam2.json | grep -o '[0-9]*$')
+
+take_exams() {
+    for i in $(seq 1 $STUDENTS); do
+        printf "student$i\npassword$i\n\n2\n$1\ny\n\nb\nc\nb\nx\nb\na\nb\nd\nanswer of student $i\nanother answer\n\n5\ny\n" |
+            "$EMS" > /dev/null
+    done
+}
+take_exams "$EXAM1"
+"$EMS" serve > /dev/null &
+SERVER_PID=$!
+sleep 0.5
+take_exams "$EXAM2"
+kill -INT $SERVER_PID
+wait $SERVER_PID || true
+
+# Reports are available after the exams end
+sleep $((END_SECONDS - $(date +%s) + 1 > 0 ? END_SECONDS - $(date +%s) + 1 : 0))
+for exam in "$EXAM1" "$EXAM2"; do
+    printf "prof\npassword123\n\n1\nn\nn\nq\n\n2\n\n3\n$exam\nn\nq\n\n4\n$exam\nn\nn\nq\n\n7\ny\n" | "$EMS" > /dev/null
+    printf "student1\npassword1\n\n1\n\n3\n$exam\n\n4\n$exam\n\n5\ny\n" | "$EMS" > /dev/null
+    "$EMS" export-results "$exam" > /dev/null
+    "$EMS" regrade "$exam" > /dev/null
+done
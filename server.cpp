@@ -0,0 +1,417 @@
+#include "storage.h"
+
+#include <cerrno>
+#include <iostream>
+#ifdef __unix__
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Socket connected to the server, -1 if no server is running (everything is read from the files)
+int server_socket = -1;
+
+#ifdef __unix__
+// Requests larger than this are rejected and the client is disconnected
+const unsigned int SERVER_MAX_REQUEST_SIZE = 16 * 1024 * 1024;
+// How often the questions of the exams which are about to start are prefetched (see QUESTIONS_PREFETCH_SECONDS)
+const int SERVER_PREFETCH_INTERVAL_MS = 60 * 1000;
+
+// A process connected to the server
+struct ServerClient
+{
+    int fd;
+    // Received bytes which are not handled yet, and responses which are not sent yet
+    string input, output;
+    // Username the client has logged in with, answers are saved for this user
+    string username;
+};
+
+// Exams never change after they're added, so the server keeps them until it stops
+unordered_map<unsigned long long, Exam> server_exams;
+volatile sig_atomic_t server_running = 0;
+
+void stop_server(int)
+{
+    server_running = 0;
+}
+
+bool send_all(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = send(fd, data, size, 0);
+        if (sent == -1 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool recv_all(int fd, char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t received = recv(fd, data, size, 0);
+        if (received == -1 && errno == EINTR) continue;
+        if (received <= 0) return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+bool read_request_string(const string &request, size_t *offset, const char **value)
+{
+    // Reads a '\0' terminated string of a request, returns false if it's missing or too long
+    size_t end = request.find('\0', *offset);
+    if (end == string::npos || end - *offset >= MAX_CHAR_ARR_LENGTH) return false;
+    *value = request.c_str() + *offset;
+    *offset = end + 1;
+    return true;
+}
+
+const Exam *server_find_exam(const char *exam_id)
+{
+    unsigned long long id_num;
+    if (!parse_exam_id(exam_id, &id_num)) return NULL;
+    unordered_map<unsigned long long, Exam>::iterator it = server_exams.find(id_num);
+    if (it == server_exams.end())
+    {
+        Exam exam;
+        if (!find_exam(exam_id, &exam)) return NULL;
+        it = server_exams.insert(make_pair(id_num, exam)).first;
+    }
+    return &it->second;
+}
+
+void handle_server_request(ServerClient *client, const string &request, string *response)
+{
+    size_t offset = 1;
+    const char *exam_id;
+    const Exam *exam;
+    response->assign(1, SERVER_OK);
+
+    switch (request[0])
+    {
+    case 'L':
+    {
+        const char *username, *password;
+        if (!read_request_string(request, &offset, &username) || !read_request_string(request, &offset, &password))
+            break;
+        const User *user = authenticate_user(username, password);
+        if (user == NULL)
+        {
+            (*response)[0] = SERVER_NOT_FOUND;
+            return;
+        }
+        client->username = username;
+        // The password is not sent back
+        User user_info = *user;
+        memset(user_info.password, 0, sizeof(user_info.password));
+        response->append((const char *)&user_info, sizeof(user_info));
+        return;
+    }
+    case 'E':
+        if (!read_request_string(request, &offset, &exam_id)) break;
+        exam = server_find_exam(exam_id);
+        if (exam == NULL)
+        {
+            (*response)[0] = SERVER_NOT_FOUND;
+            return;
+        }
+        response->append((const char *)exam, sizeof(Exam));
+        return;
+    case 'Q':
+    {
+        if (!read_request_string(request, &offset, &exam_id)) break;
+        exam = server_find_exam(exam_id);
+        const QuestionSet *question_set = exam == NULL ? NULL : find_questions(exam);
+        if (question_set == NULL)
+        {
+            (*response)[0] = SERVER_NOT_FOUND;
+            return;
+        }
+        response->append((const char *)question_set->questions.data(), question_set->questions.size() * sizeof(Question));
+        return;
+    }
+    case 'S':
+    {
+        // Only a logged in student can submit answers, and only for themselves
+        const User *user = client->username.empty() ? NULL : find_user(client->username.c_str());
+        if (user == NULL || user->role != 'S') break;
+        if (!read_request_string(request, &offset, &exam_id)) break;
+        exam = server_find_exam(exam_id);
+        const QuestionSet *question_set = exam == NULL ? NULL : find_questions(exam);
+        if (question_set == NULL)
+        {
+            (*response)[0] = SERVER_NOT_FOUND;
+            return;
+        }
+
+        unsigned int qcount, essay_count;
+        if (request.size() < offset + sizeof(qcount)) break;
+        memcpy(&qcount, request.data() + offset, sizeof(qcount));
+        offset += sizeof(qcount);
+        if (qcount != exam->qcount || request.size() < offset + qcount + sizeof(essay_count)) break;
+        const char *choices = request.data() + offset;
+        offset += qcount;
+        memcpy(&essay_count, request.data() + offset, sizeof(essay_count));
+        offset += sizeof(essay_count);
+        if (request.size() != offset + (size_t)essay_count * sizeof(Answer)) break;
+
+        vector<Answer> essay_answers(essay_count);
+        for (size_t i = 0; i < essay_count; i++)
+        {
+            memcpy(&essay_answers[i], request.data() + offset + i * sizeof(Answer), sizeof(Answer));
+            strcpy(essay_answers[i].username, user->username);
+            strcpy(essay_answers[i].exam_id, exam->id);
+            essay_answers[i].essay_answer[sizeof(Answer::essay_answer) - 1] = '\0';
+        }
+
+        int submit_status = submit_exam(exam, user->username, choices, essay_answers.data(), essay_answers.size());
+        if (submit_status == 1)
+            (*response)[0] = SERVER_ALREADY_TAKEN;
+        else if (submit_status == -1)
+            (*response)[0] = SERVER_ERROR;
+        return;
+    }
+    }
+
+    // Unknown command or malformed request
+    response->assign(1, SERVER_ERROR);
+}
+
+bool serve_client(ServerClient *client)
+{
+    // Handles the requests of a client which poll() reported, returns false if the client should be disconnected
+    char buffer[4096];
+    while (true)
+    {
+        ssize_t received = recv(client->fd, buffer, sizeof(buffer), 0);
+        if (received > 0)
+            client->input.append(buffer, received);
+        else if (received == 0)
+            return false;
+        else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            break;
+        else if (errno != EINTR)
+            return false;
+    }
+
+    size_t offset = 0;
+    while (client->input.size() - offset >= sizeof(unsigned int))
+    {
+        unsigned int request_size;
+        memcpy(&request_size, client->input.data() + offset, sizeof(request_size));
+        if (request_size == 0 || request_size > SERVER_MAX_REQUEST_SIZE) return false;
+        if (client->input.size() - offset - sizeof(request_size) < request_size) break;
+        string request = client->input.substr(offset + sizeof(request_size), request_size);
+        offset += sizeof(request_size) + request_size;
+
+        string response;
+        handle_server_request(client, request, &response);
+        unsigned int response_size = response.size();
+        client->output.append((const char *)&response_size, sizeof(response_size));
+        client->output += response;
+    }
+    client->input.erase(0, offset);
+
+    // Sending as much as the socket accepts, the rest is sent when poll() reports the socket is writable
+    while (!client->output.empty())
+    {
+        ssize_t sent = send(client->fd, client->output.data(), client->output.size(), 0);
+        if (sent > 0)
+            client->output.erase(0, sent);
+        else if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else if (sent == 0 || errno != EINTR)
+            return false;
+    }
+    return true;
+}
+#endif
+
+void run_server()
+{
+#ifdef __unix__
+    if (!create_data_directory())
+    {
+        cout << "*** Error: Couldn't create the data directory. ***\n";
+        return;
+    }
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SERVER_SOCKET_PATH);
+
+    // The socket file might be left by a server which didn't stop properly, or another server might be running
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd != -1 && connect(listen_fd, (sockaddr *)&address, sizeof(address)) == 0)
+    {
+        cout << "*** Error: Another EMS server is already running. ***\n";
+        close(listen_fd);
+        return;
+    }
+    if (listen_fd != -1) close(listen_fd);
+    unlink(SERVER_SOCKET_PATH);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd == -1 || bind(listen_fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0)
+    {
+        cout << "*** Error: Couldn't create " << SERVER_SOCKET_PATH << ", check for file permissions. ***\n";
+        if (listen_fd != -1) close(listen_fd);
+        return;
+    }
+    fcntl(listen_fd, F_SETFL, O_NONBLOCK);
+
+    // Stopping on Ctrl+C, and not being killed by writing to a client which has exited
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, stop_server);
+    signal(SIGTERM, stop_server);
+    server_running = 1;
+
+    sync_users_index();
+    sync_exams_index();
+    int replayed_count = replay_answer_logs();
+    if (replayed_count > 0) cout << "Submitted the answers of " << replayed_count << " unfinished exam sessions.\n";
+    cout << "EMS server is running on " << SERVER_SOCKET_PATH << ", press Ctrl+C to stop it.\n";
+
+    // One thread serves all the clients, poll() reports which of them have sent requests
+    vector<ServerClient> clients;
+    vector<pollfd> poll_fds;
+    time_t next_prefetch_time = 0;
+    while (server_running)
+    {
+        // Loading the questions of the exams which are about to start and dropping the ones of ended exams
+        time_t time_now = time(NULL);
+        if (time_now >= next_prefetch_time)
+        {
+            prefetch_questions(time_now, time_now + QUESTIONS_PREFETCH_SECONDS);
+            release_questions(time_now);
+            next_prefetch_time = time_now + SERVER_PREFETCH_INTERVAL_MS / 1000;
+        }
+
+        poll_fds.clear();
+        pollfd listen_poll = {listen_fd, POLLIN, 0};
+        poll_fds.push_back(listen_poll);
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            pollfd client_poll = {clients[i].fd, (short)(POLLIN | (clients[i].output.empty() ? 0 : POLLOUT)), 0};
+            poll_fds.push_back(client_poll);
+        }
+        if (poll(poll_fds.data(), poll_fds.size(), SERVER_PREFETCH_INTERVAL_MS) == -1)
+        {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (size_t i = 0; i < clients.size(); i++)
+        {
+            if (poll_fds[i + 1].revents != 0 && !serve_client(&clients[i]))
+            {
+                close(clients[i].fd);
+                clients[i].fd = -1;
+            }
+        }
+        for (size_t i = clients.size(); i-- > 0;)
+        {
+            if (clients[i].fd == -1) clients.erase(clients.begin() + i);
+        }
+
+        if (poll_fds[0].revents & POLLIN)
+        {
+            int client_fd;
+            while ((client_fd = accept(listen_fd, NULL, NULL)) != -1)
+            {
+                fcntl(client_fd, F_SETFL, O_NONBLOCK);
+                ServerClient client;
+                client.fd = client_fd;
+                clients.push_back(client);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < clients.size(); i++)
+        close(clients[i].fd);
+    close(listen_fd);
+    unlink(SERVER_SOCKET_PATH);
+    cout << "EMS server stopped.\n";
+#else
+    cout << "*** Error: The server mode is only supported on unix systems. ***\n";
+#endif
+}
+
+bool connect_to_server()
+{
+#ifdef __unix__
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1) return false;
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SERVER_SOCKET_PATH);
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return false;
+    }
+    // If the server stops, writing to the socket must not kill this process
+    signal(SIGPIPE, SIG_IGN);
+    server_socket = fd;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool server_request(const string &request, string *response)
+{
+    /* Sends a request to the server and waits for its response
+     * Returns false if there's no server or it's not reachable anymore, then the files are used instead
+     */
+#ifdef __unix__
+    if (server_socket == -1) return false;
+    unsigned int size = request.size();
+    string frame((const char *)&size, sizeof(size));
+    frame += request;
+    if (send_all(server_socket, frame.data(), frame.size()) &&
+        recv_all(server_socket, (char *)&size, sizeof(size)) && size > 0)
+    {
+        response->resize(size);
+        if (recv_all(server_socket, &(*response)[0], size)) return true;
+    }
+    close(server_socket);
+    server_socket = -1;
+#endif
+    return false;
+}
+
+bool server_submit_exam(const Exam *exam, const char *choices, const vector<Answer> &essay_answers, int *submit_status)
+{
+    // Returns false if there's no server, otherwise *submit_status is set like the return value of submit_exam()
+    if (server_socket == -1) return false;
+    string request = string("S") + exam->id + '\0';
+    unsigned int count = exam->qcount;
+    request.append((const char *)&count, sizeof(count));
+    request.append(choices, count);
+    count = essay_answers.size();
+    request.append((const char *)&count, sizeof(count));
+    if (count > 0) request.append((const char *)essay_answers.data(), count * sizeof(Answer));
+
+    string response;
+    if (!server_request(request, &response)) return false;
+    if (response[0] == SERVER_OK)
+        *submit_status = 0;
+    else if (response[0] == SERVER_ALREADY_TAKEN)
+        *submit_status = 1;
+    else
+        *submit_status = -1;
+    return true;
+}
@@ -0,0 +1,1473 @@
+#include "storage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <sys/stat.h>
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#elif _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <io.h>
+#include <windows.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+// The AVX2 grading kernel is compiled into every x86-64 build and used only if the CPU has AVX2
+#if defined(__GNUC__) && defined(__x86_64__)
+#define GRADE_WITH_AVX2
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+vector<User> users_table;
+unordered_map<string, size_t> users_index;
+
+unordered_map<unsigned long long, unsigned int> exams_index;
+unsigned int exams_indexed_count = 0;
+size_t exams_idx_read_count = 0;
+
+unordered_map<unsigned int, unordered_set<unsigned long long>> exams_of_student;
+size_t enrollments_read_count = 0;
+
+/* Random number generator for exam IDs
+ * IDs are 64-bit, so collisions are practically impossible no matter how many exams exist
+ * (rand() returns at most 32767 on Windows)
+ */
+mt19937_64 exam_id_generator;
+
+// Question sets by the numeric exam ID
+unordered_map<unsigned long long, QuestionSet> question_sets;
+
+MetricCounters metric_counters;
+
+const User *authenticate_user(const char *username, const char *password)
+{
+    // Checking if the login is valid (username exists and password is correct), returns the user if it is
+    const User *user = find_user(username);
+    if (user == NULL || strcmp(user->password, password) != 0)
+        return NULL;
+    return user;
+}
+
+bool username_exists(char *username)
+{
+    return find_user(username) != NULL;
+}
+
+void sync_users_index()
+{
+    RecordFile<User> users_file("./data/users.dat");
+
+    // Indexing only the records which are not indexed yet
+    for (size_t i = users_table.size(); i < users_file.size(); i++)
+    {
+        // If a username is repeated, the first registered user is kept
+        if (users_index.find(users_file[i].username) == users_index.end())
+            users_index[users_file[i].username] = users_table.size();
+        users_table.push_back(users_file[i]);
+    }
+}
+
+long find_user_record(const char *username)
+{
+    // Returns the position of the user in users.dat, or -1 if there's no user with this username
+    const User *user = find_user(username);
+    if (user == NULL) return -1;
+    return user - &users_table[0];
+}
+
+const User *find_user(const char *username)
+{
+    const User *user = lookup_user(username);
+    if (user == NULL)
+    {
+        // The user might have been registered after the last sync
+        sync_users_index();
+        user = lookup_user(username);
+    }
+    return user;
+}
+
+const User *lookup_user(const char *username)
+{
+    // Only looks in the index, doesn't touch users.dat even if the user is not found
+    unordered_map<string, size_t>::iterator it = users_index.find(username);
+    if (it == users_index.end()) return NULL;
+    return &users_table[it->second];
+}
+
+bool rand_id_exists(char *rand_id)
+{
+    return find_exam_record(rand_id) != -1;
+}
+
+bool parse_exam_id(const char *exam_id, unsigned long long *id_num)
+{
+    // Exam IDs are decimal numbers without leading zeros (like the ones made by to_string())
+    if (exam_id[0] < '0' || exam_id[0] > '9' || (exam_id[0] == '0' && exam_id[1] != '\0'))
+        return false;
+    char *end;
+    *id_num = strtoull(exam_id, &end, 10);
+    return *end == '\0';
+}
+
+void sync_exams_index()
+{
+    // Loading the entries appended to exams.idx since the last sync (by this or other processes)
+    RecordFile<ExamIndexEntry> idx_file("./data/exams.idx", true);
+    for (; exams_idx_read_count < idx_file.size(); exams_idx_read_count++)
+    {
+        const ExamIndexEntry &entry = idx_file[exams_idx_read_count];
+        // If an ID is repeated, the first exam is kept
+        exams_index.insert(make_pair(entry.id, entry.record_num));
+        /* Records are indexed in order, so every record before an indexed one has been indexed
+         * (records with an invalid ID have no entry, they're skipped instead of being indexed again)
+         */
+        if (entry.record_num >= exams_indexed_count) exams_indexed_count = entry.record_num + 1;
+    }
+
+    /* Indexing the exams.dat records which are not indexed yet
+     * Their entries are appended to exams.idx, so the next startup doesn't need to read them
+     */
+    RecordFile<Exam> exams_file("./data/exams.dat");
+    vector<ExamIndexEntry> new_entries;
+    for (; exams_indexed_count < exams_file.size(); exams_indexed_count++)
+    {
+        ExamIndexEntry entry;
+        entry.record_num = exams_indexed_count;
+        if (!parse_exam_id(exams_file[exams_indexed_count].id, &entry.id)) continue;
+
+        exams_index.insert(make_pair(entry.id, entry.record_num));
+        new_entries.push_back(entry);
+    }
+    if (!new_entries.empty())
+        idx_file.append(new_entries.data(), new_entries.size());
+}
+
+long find_exam_record(const char *exam_id)
+{
+    // Returns the position of the exam in exams.dat, or -1 if there's no exam with this ID
+    unsigned long long id_num;
+    if (!parse_exam_id(exam_id, &id_num)) return -1;
+
+    unordered_map<unsigned long long, unsigned int>::iterator it = exams_index.find(id_num);
+    if (it == exams_index.end())
+    {
+        // The exam might have been added after the last sync
+        sync_exams_index();
+        it = exams_index.find(id_num);
+        if (it == exams_index.end()) return -1;
+    }
+    return it->second;
+}
+
+bool find_exam(const char *exam_id, Exam *exam)
+{
+    string response;
+    if (server_request(string("E") + exam_id + '\0', &response))
+    {
+        if (response[0] != SERVER_OK || response.size() != 1 + sizeof(Exam)) return false;
+        memcpy(exam, response.data() + 1, sizeof(Exam));
+        return true;
+    }
+
+    long record_num = find_exam_record(exam_id);
+    if (record_num == -1) return false;
+
+    // Copying only the found exam from exams.dat
+    RecordFile<Exam> exams_file("./data/exams.dat");
+    if ((size_t)record_num >= exams_file.size()) return false;
+    *exam = exams_file[record_num];
+    return strcmp(exam->id, exam_id) == 0;
+}
+
+void sync_enrollments()
+{
+    RecordFile<Enrollment> enrollments_file("./data/enrollments.dat");
+    for (; enrollments_read_count < enrollments_file.size(); enrollments_read_count++)
+    {
+        const Enrollment &enrollment = enrollments_file[enrollments_read_count];
+        exams_of_student[enrollment.user_num].insert(enrollment.exam_id);
+    }
+}
+
+bool has_taken_exam(const char *username, const char *exam_id)
+{
+    long user_num = find_user_record(username);
+    unsigned long long id_num;
+    if (user_num == -1 || !parse_exam_id(exam_id, &id_num)) return false;
+
+    // The enrollment might have been added after the last sync (by this or other processes)
+    unordered_map<unsigned int, unordered_set<unsigned long long>>::iterator it = exams_of_student.find(user_num);
+    if (it == exams_of_student.end() || it->second.count(id_num) == 0)
+    {
+        sync_enrollments();
+        it = exams_of_student.find(user_num);
+    }
+    if (it != exams_of_student.end() && it->second.count(id_num) > 0) return true;
+
+    // Map file of the student, if the data has not been migrated yet
+    char exam_map_file_path[MAX_CHAR_ARR_LENGTH] = "./data/map_";
+    strcat(exam_map_file_path, username);
+    strcat(exam_map_file_path, ".dat");
+    RecordFile<char> student_exam_map(exam_map_file_path);
+    for (size_t offset = 0; offset + sizeof(Exam::id) <= student_exam_map.size(); offset += sizeof(Exam::id))
+    {
+        if (strcmp(student_exam_map.begin() + offset, exam_id) == 0) return true;
+    }
+    return false;
+}
+
+bool add_enrollment(const char *username, const char *exam_id)
+{
+    // Adds the enrollment if the student doesn't have it already, returns false if it couldn't be saved
+    Enrollment enrollment;
+    long user_num = find_user_record(username);
+    if (user_num == -1 || !parse_exam_id(exam_id, &enrollment.exam_id)) return false;
+    enrollment.user_num = user_num;
+
+    // Locked, so the same enrollment can't be added by two processes
+    RecordFile<Enrollment> enrollments_file("./data/enrollments.dat", true);
+    if (!enrollments_file.lock()) return false;
+    sync_enrollments();
+    bool saved = exams_of_student[enrollment.user_num].count(enrollment.exam_id) > 0 ||
+                 enrollments_file.append(&enrollment) == 1;
+    enrollments_file.unlock();
+    sync_enrollments();
+    return saved;
+}
+
+bool compare_users_by_lname(unsigned int user_num1, unsigned int user_num2)
+{
+    int order = strcmp(users_table[user_num1].lname, users_table[user_num2].lname);
+    return order < 0 || (order == 0 && user_num1 < user_num2);
+}
+
+bool compare_exams_by_start(const ExamStartEntry &entry1, const ExamStartEntry &entry2)
+{
+    return entry1.start_time < entry2.start_time ||
+           (entry1.start_time == entry2.start_time && entry1.record_num < entry2.record_num);
+}
+
+void merge_users_tail(const RecordFile<unsigned int> &index_file, vector<unsigned int> *sorted_users)
+{
+    /* Sorting only the users of the tail and merging them with the already sorted ones
+     * An index with more users than users_table (users.dat couldn't be read) is not used, all users are sorted
+     */
+    size_t indexed_count = index_file.size() <= users_table.size() ? index_file.size() : 0;
+    vector<unsigned int> new_users;
+    for (size_t i = indexed_count; i < users_table.size(); i++)
+        new_users.push_back(i);
+    sort(new_users.begin(), new_users.end(), compare_users_by_lname);
+
+    sorted_users->resize(indexed_count + new_users.size());
+    merge(index_file.begin(), index_file.begin() + indexed_count, new_users.begin(), new_users.end(),
+          sorted_users->begin(), compare_users_by_lname);
+}
+
+void merge_exams_tail(const RecordFile<ExamStartEntry> &index_file, const RecordFile<Exam> &exams_file,
+                      vector<ExamStartEntry> *sorted_entries)
+{
+    /* Sorting only the exams of the tail and merging them with the already sorted ones
+     * An index with more exams than exams_file (exams.dat couldn't be read) is not used, all exams are sorted
+     */
+    size_t indexed_count = index_file.size() <= exams_file.size() ? index_file.size() : 0;
+    vector<ExamStartEntry> new_entries;
+    for (size_t i = indexed_count; i < exams_file.size(); i++)
+    {
+        ExamStartEntry entry;
+        entry.start_time = exams_file[i].start_time;
+        entry.record_num = i;
+        new_entries.push_back(entry);
+    }
+    sort(new_entries.begin(), new_entries.end(), compare_exams_by_start);
+
+    sorted_entries->resize(indexed_count + new_entries.size());
+    merge(index_file.begin(), index_file.begin() + indexed_count, new_entries.begin(), new_entries.end(),
+          sorted_entries->begin(), compare_exams_by_start);
+}
+
+void update_users_by_lname_index()
+{
+    /* Merges the unsorted tail into the index file once it has SORTED_INDEX_TAIL_LIMIT users
+     * The index is locked until it's replaced, so users indexed by other processes meanwhile are not lost
+     */
+    RecordFile<unsigned int> index_file(USERS_BY_LNAME_INDEX_PATH, true);
+    if (!index_file.lock()) return;
+    sync_users_index();
+    if (index_file.size() + SORTED_INDEX_TAIL_LIMIT <= users_table.size())
+    {
+        vector<unsigned int> sorted_users;
+        merge_users_tail(index_file, &sorted_users);
+        index_file.replace(string((const char *)sorted_users.data(), sorted_users.size() * sizeof(unsigned int)));
+    }
+    index_file.unlock();
+}
+
+void update_exams_by_start_index()
+{
+    /* Merges the unsorted tail into the index file once it has SORTED_INDEX_TAIL_LIMIT exams
+     * The index is locked until it's replaced, so exams indexed by other processes meanwhile are not lost
+     */
+    RecordFile<ExamStartEntry> index_file(EXAMS_BY_START_INDEX_PATH, true);
+    if (!index_file.lock()) return;
+    RecordFile<Exam> exams_file("./data/exams.dat");
+    if (index_file.size() + SORTED_INDEX_TAIL_LIMIT <= exams_file.size())
+    {
+        vector<ExamStartEntry> sorted_entries;
+        merge_exams_tail(index_file, exams_file, &sorted_entries);
+        index_file.replace(string((const char *)sorted_entries.data(), sorted_entries.size() * sizeof(ExamStartEntry)));
+    }
+    index_file.unlock();
+}
+
+void load_users_by_lname(vector<unsigned int> *sorted_users)
+{
+    /* Positions of all the users in users.dat sorted by last name, the index file merged with its tail
+     * The index is read while it's locked, so another process can't replace it after users_table is synced.
+     * Like update_users_by_lname_index(), the merged users are saved once the tail is long enough
+     */
+    RecordFile<unsigned int> index_file(USERS_BY_LNAME_INDEX_PATH, true);
+    bool locked = index_file.lock();
+    sync_users_index();
+    merge_users_tail(index_file, sorted_users);
+    if (locked && index_file.size() + SORTED_INDEX_TAIL_LIMIT <= users_table.size())
+        index_file.replace(string((const char *)sorted_users->data(), sorted_users->size() * sizeof(unsigned int)));
+    if (locked) index_file.unlock();
+}
+
+void load_exams_by_start(vector<ExamStartEntry> *sorted_entries)
+{
+    /* Entries of all the exams in exams.dat sorted by start time, the index file merged with its tail
+     * The index is read while it's locked, so another process can't replace it meanwhile.
+     * Like update_exams_by_start_index(), the merged entries are saved once the tail is long enough
+     */
+    RecordFile<ExamStartEntry> index_file(EXAMS_BY_START_INDEX_PATH, true);
+    bool locked = index_file.lock();
+    RecordFile<Exam> exams_file("./data/exams.dat");
+    merge_exams_tail(index_file, exams_file, sorted_entries);
+    if (locked && index_file.size() + SORTED_INDEX_TAIL_LIMIT <= exams_file.size())
+        index_file.replace(
+            string((const char *)sorted_entries->data(), sorted_entries->size() * sizeof(ExamStartEntry)));
+    if (locked) index_file.unlock();
+}
+
+bool create_data_directory()
+{
+    // Creates ./data (where all the files are kept) if it doesn't exist
+    error_code error;
+    filesystem::create_directories("./data", error);
+    return !error;
+}
+
+void create_examQ_path(char *exam_path, const char *exam_id)
+{
+    strcpy(exam_path, "./data/exam_");
+    strcat(exam_path, exam_id);
+    strcat(exam_path, "_questions.dat");
+}
+
+void create_examA_path(char *exam_path, const char *exam_id)
+{
+    strcpy(exam_path, "./data/exam_");
+    strcat(exam_path, exam_id);
+    strcat(exam_path, "_answers.dat");
+}
+
+void create_examR_path(char *exam_path, const char *exam_id)
+{
+    strcpy(exam_path, "./data/exam_");
+    strcat(exam_path, exam_id);
+    strcat(exam_path, "_results.dat");
+}
+
+void create_examC_path(char *exam_path, const char *exam_id)
+{
+    strcpy(exam_path, "./data/exam_");
+    strcat(exam_path, exam_id);
+    strcat(exam_path, "_choices.dat");
+}
+
+void create_session_log_path(char *log_path, const char *exam_id, const char *username)
+{
+    strcpy(log_path, "./data/session_");
+    strcat(log_path, exam_id);
+    strcat(log_path, "_");
+    strcat(log_path, username);
+    strcat(log_path, ".wal");
+}
+
+void encode_answer(const Answer *answer, string *buffer)
+{
+    // Appends the answer in the compact format to buffer
+    unsigned char username_length = strlen(answer->username);
+    buffer->append((const char *)&answer->qnum, sizeof(answer->qnum));
+    buffer->push_back(answer->is_multiple_choice);
+    buffer->push_back(username_length);
+    buffer->append(answer->username, username_length + 1);
+    if (answer->is_multiple_choice)
+        buffer->push_back(answer->chosen);
+    else
+    {
+        unsigned short essay_length = strlen(answer->essay_answer);
+        buffer->append((const char *)&essay_length, sizeof(essay_length));
+        buffer->append(answer->essay_answer, essay_length + 1);
+    }
+}
+
+bool append_answers(const char *answers_path, const Answer *answers, size_t count)
+{
+    RecordFile<char> answers_file(answers_path, true);
+    // Locked so another process can't write the header of a new file meanwhile
+    if (!answers_file.lock()) return false;
+
+    string buffer;
+    if (answers_file.size() > 0 && (answers_file.size() < sizeof(ANSWERS_FILE_MAGIC) ||
+                                    memcmp(answers_file.begin(), ANSWERS_FILE_MAGIC, sizeof(ANSWERS_FILE_MAGIC)) != 0))
+    {
+        // The file is in the old format (not migrated yet), so the answers are appended as Answer structs
+        buffer.append((const char *)answers, count * sizeof(Answer));
+    }
+    else
+    {
+        if (answers_file.size() == 0)
+        {
+            // New file, writing the header of the compact format
+            buffer.append(ANSWERS_FILE_MAGIC, sizeof(ANSWERS_FILE_MAGIC));
+            buffer.append((const char *)&ANSWERS_FILE_VERSION, sizeof(ANSWERS_FILE_VERSION));
+        }
+        for (size_t i = 0; i < count; i++)
+            encode_answer(&answers[i], &buffer);
+    }
+    bool saved = answers_file.append(buffer.data(), buffer.size()) == buffer.size();
+    answers_file.unlock();
+    return saved;
+}
+
+bool replace_file(const char *path, const string &data)
+{
+    /* Writes the data next to the file and then replaces the file with it
+     * The new file is written to the disk before the rename, so a crash can't leave the file empty or partial
+     */
+    char new_path[MAX_CHAR_ARR_LENGTH + 4];
+    strcpy(new_path, path);
+    strcat(new_path, ".new");
+    FILE *new_file = fopen(new_path, "wb");
+    if (new_file == NULL) return false;
+    bool written = fwrite(data.data(), 1, data.size(), new_file) == data.size() && fflush(new_file) == 0;
+#ifdef __unix__
+    written = written && fsync(fileno(new_file)) == 0;
+#elif _WIN32
+    written = written && _commit(_fileno(new_file)) == 0;
+#endif
+    if (fclose(new_file) != 0) written = false;
+    if (!written)
+    {
+        remove(new_path);
+        return false;
+    }
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows, MoveFileEx() replaces it in one step
+    return MoveFileExA(new_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return rename(new_path, path) == 0;
+#endif
+}
+
+void load_answer_key(const Question *questions, size_t question_count, unsigned int qcount, vector<char> *key)
+{
+    // The key has the correct option of each multiple choice question and '\0' for essay questions
+    key->assign(qcount, '\0');
+    for (size_t i = 0; i < question_count; i++)
+    {
+        if (questions[i].is_multiple_choice && questions[i].qnum >= 1 && questions[i].qnum <= qcount)
+            (*key)[questions[i].qnum - 1] = questions[i].correct;
+    }
+}
+
+#ifdef GRADE_WITH_AVX2
+__attribute__((target("avx2"))) unsigned int grade_choices_avx2(const char *key, const char *choices, unsigned int qcount,
+                                                              unsigned int *answered_count, unsigned int *correct_count,
+                                                              unsigned int *blank_count)
+{
+    // Counts the choices of grade_choices() 32 at a time, returns the number of choices counted
+    const __m256i zeros = _mm256_setzero_si256(), blanks = _mm256_set1_epi8('x');
+    unsigned int i = 0;
+    for (; i + 32 <= qcount; i += 32)
+    {
+        __m256i key_bytes = _mm256_loadu_si256((const __m256i *)(key + i));
+        __m256i choice_bytes = _mm256_loadu_si256((const __m256i *)(choices + i));
+        unsigned int answered_mask = ~(unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(choice_bytes, zeros));
+        *answered_count += __builtin_popcount(answered_mask);
+        *correct_count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(choice_bytes, key_bytes)) & answered_mask);
+        *blank_count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(choice_bytes, blanks)));
+    }
+    return i;
+}
+#endif
+
+void grade_choices(const char *key, const char *choices, unsigned int qcount, Result *result)
+{
+    /* Counts the answered ('\0' is not answered), correct and blank ('x') choices of a row
+     * 32 or 16 choices are compared at once with AVX2 (if the CPU has it) or SSE2 instructions
+     */
+    unsigned int answered_count = 0, correct_count = 0, blank_count = 0;
+    unsigned int i = 0;
+#ifdef GRADE_WITH_AVX2
+    static const bool cpu_has_avx2 = __builtin_cpu_supports("avx2");
+    if (cpu_has_avx2) i = grade_choices_avx2(key, choices, qcount, &answered_count, &correct_count, &blank_count);
+#endif
+#ifdef __SSE2__
+    const __m128i zeros = _mm_setzero_si128(), blanks = _mm_set1_epi8('x');
+    for (; i + 16 <= qcount; i += 16)
+    {
+        __m128i key_bytes = _mm_loadu_si128((const __m128i *)(key + i));
+        __m128i choice_bytes = _mm_loadu_si128((const __m128i *)(choices + i));
+        unsigned int answered_mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(choice_bytes, zeros)) & 0xFFFF;
+        answered_count += __builtin_popcount(answered_mask);
+        correct_count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(choice_bytes, key_bytes)) & answered_mask);
+        blank_count += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(choice_bytes, blanks)));
+    }
+#endif
+    for (; i < qcount; i++)
+    {
+        if (choices[i] == '\0') continue;
+        answered_count++;
+        if (choices[i] == key[i])
+            correct_count++;
+        else if (choices[i] == 'x')
+            blank_count++;
+    }
+
+    result->multiple_choice_count = answered_count;
+    result->correct_choices_count = correct_count;
+    result->wrong_choices_count = answered_count - correct_count - blank_count;
+    calculate_score(result);
+}
+
+void calculate_score(Result *result)
+{
+    // Calculating multiple choice score ((3*correct - wrong) / (3*total)) * 100
+    if (result->multiple_choice_count > 0)
+    {
+        result->multiple_choice_percent = (3 * result->correct_choices_count) - result->wrong_choices_count;
+        result->multiple_choice_percent /= (3 * result->multiple_choice_count);
+        result->multiple_choice_percent *= 100;
+    }
+    else
+    {
+        result->multiple_choice_percent = 100;
+    }
+}
+
+int regrade_exam(const char *exam_id)
+{
+    /* Grades all the rows of the exam's choices file, and the multiple choice answers still in an answers file
+     * which wasn't migrated, again with the current answer key and rewrites the results file,
+     * returns the number of regraded results or -1 on error
+     */
+    Exam exam;
+    sync_users_index();
+    if (!find_exam(exam_id, &exam)) return -1;
+
+    char questions_path[MAX_CHAR_ARR_LENGTH], choices_path[MAX_CHAR_ARR_LENGTH];
+    char answers_path[MAX_CHAR_ARR_LENGTH], results_path[MAX_CHAR_ARR_LENGTH];
+    create_examQ_path(questions_path, exam.id);
+    create_examC_path(choices_path, exam.id);
+    create_examA_path(answers_path, exam.id);
+    create_examR_path(results_path, exam.id);
+    RecordFile<Question> questions_file(questions_path);
+    // The results file stays locked until it's replaced, so no results are appended meanwhile
+    RecordFile<Result> results_file(results_path, true);
+    if (!results_file.lock()) return -1;
+    ChoiceMatrix choices_file(choices_path);
+    // Exams taken only before the upgrade might not have a choices file (like "ems migrate")
+    unsigned int qcount = choices_file.is_open() ? choices_file.question_count() : exam.qcount;
+
+    vector<char> answer_key;
+    load_answer_key(questions_file.begin(), questions_file.size(), qcount, &answer_key);
+
+    // Finding the result of each student by their username
+    vector<Result> results(results_file.begin(), results_file.end());
+    unordered_map<string, size_t> result_of_username;
+    for (size_t i = 0; i < results.size(); i++)
+        result_of_username[results[i].username] = i;
+
+    int regraded_count = 0;
+    for (size_t row = 0; row < choices_file.size(); row++)
+    {
+        if (choices_file.user_num(row) >= users_table.size()) continue;
+        unordered_map<string, size_t>::iterator it = result_of_username.find(users_table[choices_file.user_num(row)].username);
+        if (it == result_of_username.end()) continue;
+
+        grade_choices(answer_key.data(), choices_file.choices(row), qcount, &results[it->second]);
+        // Graded once, a student with a row isn't graded again from the answers file
+        result_of_username.erase(it);
+        regraded_count++;
+    }
+
+    // Multiple choice answers of exams taken before the answers file was migrated (like change_answer_key())
+    unordered_map<string, vector<char> > old_choices;
+    AnswerReader answers_file(answers_path);
+    AnswerRecord answer;
+    while (answers_file.next(&answer))
+    {
+        if (!answer.is_multiple_choice || answer.qnum < 1 || answer.qnum > qcount) continue;
+        vector<char> &choices = old_choices[answer.username];
+        if (choices.empty()) choices.assign(qcount, '\0');
+        choices[answer.qnum - 1] = answer.chosen;
+    }
+    for (unordered_map<string, vector<char> >::iterator it = old_choices.begin(); it != old_choices.end(); it++)
+    {
+        unordered_map<string, size_t>::iterator result_it = result_of_username.find(it->first);
+        if (result_it == result_of_username.end()) continue;
+
+        grade_choices(answer_key.data(), it->second.data(), qcount, &results[result_it->second]);
+        regraded_count++;
+    }
+
+    string results_data((const char *)results.data(), results.size() * sizeof(Result));
+    // Closing the other files first, open files can't be replaced on Windows
+    questions_file.close_file();
+    choices_file.close_file();
+    answers_file.close_file();
+    if (!results_file.replace(results_data)) return -1;
+    return regraded_count;
+}
+
+int change_answer_key(const char *exam_id, unsigned int qnum, char new_correct)
+{
+    /* Changes the correct option of a multiple choice question and updates the counts of only the
+     * results of the students who chose the old or the new correct option,
+     * returns the number of updated results or -1 on error
+     */
+    char questions_path[MAX_CHAR_ARR_LENGTH], choices_path[MAX_CHAR_ARR_LENGTH];
+    char answers_path[MAX_CHAR_ARR_LENGTH], results_path[MAX_CHAR_ARR_LENGTH];
+    create_examQ_path(questions_path, exam_id);
+    create_examC_path(choices_path, exam_id);
+    create_examA_path(answers_path, exam_id);
+    create_examR_path(results_path, exam_id);
+
+    /* The results file stays locked until it's replaced, so no results are appended meanwhile.
+     * It's locked before the questions file is read, so two changes of the key can't both read the old key
+     * and a submission saved meanwhile (graded under the same lock) is graded with either the old or the new key
+     */
+    RecordFile<Result> results_file(results_path, true);
+    if (!results_file.lock()) return -1;
+
+    RecordFile<Question> questions_file(questions_path);
+    vector<Question> questions(questions_file.begin(), questions_file.end());
+    size_t question_index = 0;
+    while (question_index < questions.size() && questions[question_index].qnum != qnum)
+        question_index++;
+    if (question_index == questions.size() || !questions[question_index].is_multiple_choice) return -1;
+
+    char old_correct = questions[question_index].correct;
+    if (old_correct == new_correct) return 0;
+    questions[question_index].correct = new_correct;
+
+    // Finding the students whose choice for the question was or now is the correct option
+    unordered_map<string, char> affected_choices;
+    sync_users_index();
+    ChoiceMatrix choices_file(choices_path);
+    if (qnum >= 1 && qnum <= choices_file.question_count())
+    {
+        for (size_t row = 0; row < choices_file.size(); row++)
+        {
+            char chosen = choices_file.choices(row)[qnum - 1];
+            if ((chosen == old_correct || chosen == new_correct) && choices_file.user_num(row) < users_table.size())
+                affected_choices[users_table[choices_file.user_num(row)].username] = chosen;
+        }
+    }
+    // Multiple choice answers of exams taken before the answers file was migrated
+    AnswerReader answers_file(answers_path);
+    AnswerRecord answer;
+    while (answers_file.next(&answer))
+    {
+        if (answer.is_multiple_choice && answer.qnum == qnum && (answer.chosen == old_correct || answer.chosen == new_correct))
+            affected_choices[answer.username] = answer.chosen;
+    }
+
+    vector<Result> results(results_file.begin(), results_file.end());
+    int updated_count = 0;
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        unordered_map<string, char>::iterator it = affected_choices.find(results[i].username);
+        if (it == affected_choices.end()) continue;
+
+        if (it->second == old_correct)
+        {
+            results[i].correct_choices_count--;
+            results[i].wrong_choices_count++;
+        }
+        else
+        {
+            results[i].correct_choices_count++;
+            results[i].wrong_choices_count--;
+        }
+        calculate_score(&results[i]);
+        updated_count++;
+    }
+
+    /* The questions file is replaced first, if EMS stops before the results file is replaced
+     * "ems regrade <exam_id>" grades the whole exam again with the new key
+     */
+    string questions_data((const char *)questions.data(), questions.size() * sizeof(Question));
+    if (!questions_file.replace(questions_data)) return -1;
+    if (updated_count > 0)
+    {
+        string results_data((const char *)results.data(), results.size() * sizeof(Result));
+        if (!results_file.replace(results_data)) return -1;
+    }
+    return updated_count;
+}
+
+bool append_choices(const char *choices_path, unsigned int qcount, unsigned int user_num, const char *choices)
+{
+    RecordFile<char> choices_file(choices_path, true);
+    // Locked so another process can't write the header of a new file meanwhile
+    if (!choices_file.lock()) return false;
+
+    string buffer;
+    if (choices_file.size() == 0)
+    {
+        // New file (exam created by an older version of EMS), writing the header
+        buffer.append(CHOICES_FILE_MAGIC, sizeof(CHOICES_FILE_MAGIC));
+        buffer.append((const char *)&qcount, sizeof(qcount));
+    }
+    else
+    {
+        ChoiceMatrix matrix(choices_path);
+        if (matrix.question_count() != qcount)
+        {
+            choices_file.unlock();
+            return false;
+        }
+    }
+    buffer.append((const char *)&user_num, sizeof(user_num));
+    buffer.append(choices, qcount);
+    bool saved = choices_file.append(buffer.data(), buffer.size()) == buffer.size();
+    choices_file.unlock();
+    return saved;
+}
+
+bool load_questions(const Exam *exam, vector<Question> *questions)
+{
+    // Reads the questions of the exam from the server, or from the exam's questions file if there's no server
+    string response;
+    if (server_request(string("Q") + exam->id + '\0', &response))
+    {
+        if (response[0] != SERVER_OK || (response.size() - 1) % sizeof(Question) != 0) return false;
+        questions->resize((response.size() - 1) / sizeof(Question));
+        if (!questions->empty()) memcpy(questions->data(), response.data() + 1, response.size() - 1);
+        return true;
+    }
+
+    const QuestionSet *question_set = find_questions(exam);
+    if (question_set == NULL) return false;
+    *questions = question_set->questions;
+    return true;
+}
+
+const QuestionSet *find_questions(const Exam *exam)
+{
+    // Returns the question set of the exam, it's read if it's not cached yet or the questions file was replaced
+    unsigned long long id_num;
+    if (!parse_exam_id(exam->id, &id_num)) return NULL;
+    char questions_path[MAX_CHAR_ARR_LENGTH];
+    create_examQ_path(questions_path, exam->id);
+    struct stat file_stat;
+    if (stat(questions_path, &file_stat) != 0) return NULL;
+
+    unordered_map<unsigned long long, QuestionSet>::iterator it = question_sets.find(id_num);
+    if (it != question_sets.end() && it->second.device == (unsigned long long)file_stat.st_dev &&
+        it->second.inode == (unsigned long long)file_stat.st_ino && it->second.size == (long long)file_stat.st_size &&
+        it->second.modified_time == file_stat.st_mtime)
+        return &it->second;
+
+    RecordFile<Question> questions_file(questions_path);
+    if (!questions_file.is_open()) return NULL;
+    QuestionSet &question_set = question_sets[id_num];
+    question_set.questions.assign(questions_file.begin(), questions_file.end());
+    load_answer_key(question_set.questions.data(), question_set.questions.size(), exam->qcount, &question_set.answer_key);
+    question_set.end_time = exam->end_time;
+    question_set.device = file_stat.st_dev;
+    question_set.inode = file_stat.st_ino;
+    question_set.size = file_stat.st_size;
+    question_set.modified_time = file_stat.st_mtime;
+    return &question_set;
+}
+
+int prefetch_questions(time_t from, time_t until)
+{
+    // Reads the question sets of the exams starting between from and until, returns the number of sets
+    vector<ExamStartEntry> sorted_entries;
+    load_exams_by_start(&sorted_entries);
+    RecordFile<Exam> exams_file("./data/exams.dat");
+    ExamStartEntry first_entry;
+    first_entry.start_time = from;
+    first_entry.record_num = 0;
+    int prefetched_count = 0;
+    for (vector<ExamStartEntry>::const_iterator entry = lower_bound(sorted_entries.begin(), sorted_entries.end(),
+                                                                    first_entry, compare_exams_by_start);
+         entry != sorted_entries.end() && entry->start_time <= until; entry++)
+    {
+        if (entry->record_num < exams_file.size() && find_questions(&exams_file[entry->record_num]) != NULL)
+            prefetched_count++;
+    }
+    return prefetched_count;
+}
+
+void release_questions(time_t ended_before)
+{
+    // Drops the question sets of the exams which ended before ended_before, they're read again if they're needed
+    for (unordered_map<unsigned long long, QuestionSet>::iterator it = question_sets.begin(); it != question_sets.end();)
+    {
+        if (it->second.end_time < ended_before)
+            it = question_sets.erase(it);
+        else
+            ++it;
+    }
+}
+
+int submit_exam(const Exam *exam, const char *username, const char *choices, const Answer *essay_answers,
+                size_t essay_count, bool resume)
+{
+    /* Grades and saves the answers of a student who took the exam (by take_exam(), the server or replay_answer_log())
+     * The files are written in a fixed order: answers, choices, result and then the enrollment of the student,
+     * a student has taken the exam once their result is saved.
+     * resume: the submission was committed to the student's answer log and might have been partially saved
+     * before a crash, so each file is written only if it doesn't have the student's data yet
+     * (replaying a submission any number of times saves it exactly once).
+     * Returns 0 on success, 1 if the student has already taken the exam or -1 if the answers couldn't be saved
+     */
+    /* The results file stays locked while the answers are graded and saved, so the same student submitting the
+     * exam from another terminal meanwhile can be detected and their answers are not saved twice.
+     * change_answer_key() holds the same lock, so the answers are graded with the key which is current when
+     * they're saved, even if it was corrected while the student was taking the exam.
+     */
+    char results_path[MAX_CHAR_ARR_LENGTH];
+    create_examR_path(results_path, exam->id);
+    RecordFile<Result> results_file(results_path, true);
+    if (!results_file.lock()) return -1;
+    const QuestionSet *question_set = find_questions(exam);
+    if (question_set == NULL)
+    {
+        results_file.unlock();
+        return -1;
+    }
+
+    Result user_results;
+    strcpy(user_results.username, username);
+    strcpy(user_results.exam_id, exam->id);
+    strcpy(user_results.exam_name, exam->name);
+    user_results.visible_time = exam->end_time;
+    grade_choices(question_set->answer_key.data(), choices, exam->qcount, &user_results);
+    bool result_saved = false;
+    for (const Result *result = results_file.begin(); result != results_file.end() && !result_saved; result++)
+        result_saved = strcmp(result->username, username) == 0;
+    if (result_saved && !resume)
+    {
+        results_file.unlock();
+        return 1;
+    }
+
+    if (!result_saved)
+    {
+        char choices_path[MAX_CHAR_ARR_LENGTH], answers_path[MAX_CHAR_ARR_LENGTH];
+        create_examC_path(choices_path, exam->id);
+        create_examA_path(answers_path, exam->id);
+        long user_num = find_user_record(username);
+
+        bool answers_saved = essay_count == 0, choices_saved = false;
+        if (resume)
+        {
+            AnswerReader answers_file(answers_path);
+            AnswerRecord answer;
+            while (!answers_saved && answers_file.next(&answer))
+                answers_saved = strcmp(answer.username, username) == 0;
+            ChoiceMatrix choices_file(choices_path);
+            for (size_t row = 0; row < choices_file.size() && !choices_saved; row++)
+                choices_saved = choices_file.user_num(row) == (unsigned long)user_num;
+        }
+        if ((!answers_saved && !append_answers(answers_path, essay_answers, essay_count)) ||
+            (!choices_saved && !append_choices(choices_path, exam->qcount, user_num, choices)) ||
+            results_file.append(&user_results) != 1)
+        {
+            results_file.unlock();
+            return -1;
+        }
+    }
+    results_file.unlock();
+
+    return add_enrollment(username, exam->id) ? 0 : -1;
+}
+
+unsigned int answer_checksum(const char *data, size_t size)
+{
+    // FNV-1a hash of the data
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+    return hash;
+}
+
+unsigned int read_env_setting(const char *name, unsigned int default_value)
+{
+    // Reads a positive number from an environment variable, or returns default_value if it's not set
+    const char *value = getenv(name);
+    if (value == NULL) return default_value;
+    char *end;
+    unsigned long number = strtoul(value, &end, 10);
+    if (end == value || *end != '\0' || number == 0) return default_value;
+    return number;
+}
+
+int replay_answer_log(const char *log_path)
+{
+    /* Submits the answers of an answer log left by a session which didn't end (crashed, or the terminal was closed),
+     * a log without any answers is only removed, the student didn't answer anything and can take the exam again
+     * Returns 0 if the log was replayed and removed (or didn't exist), 1 if the session is still running on
+     * another terminal, or -1 if the answers couldn't be submitted (the log is kept)
+     */
+    {
+        RecordFile<char> log_file(log_path);
+        if (!log_file.is_open()) return 0;
+        if (!log_file.lock(false)) return 1;
+
+        const char *data = log_file.begin();
+        size_t size = log_file.size();
+        Exam exam;
+        if (size >= WAL_FILE_HEADER_SIZE && memcmp(data, WAL_FILE_MAGIC, sizeof(WAL_FILE_MAGIC)) == 0 &&
+            memchr(data + sizeof(WAL_FILE_MAGIC), '\0', MAX_CHAR_ARR_LENGTH) != NULL &&
+            memchr(data + sizeof(WAL_FILE_MAGIC) + MAX_CHAR_ARR_LENGTH, '\0', MAX_CHAR_ARR_LENGTH) != NULL &&
+            find_exam(data + sizeof(WAL_FILE_MAGIC), &exam))
+        {
+            const char *username = data + sizeof(WAL_FILE_MAGIC) + MAX_CHAR_ARR_LENGTH;
+            vector<char> choices(exam.qcount, '\0');
+            vector<Answer> essay_answers;
+            size_t offset = WAL_FILE_HEADER_SIZE;
+            unsigned int answer_size, checksum;
+            AnswerRecord answer;
+            size_t answer_count = 0;
+            bool committed = false;
+            while (offset + sizeof(answer_size) + sizeof(checksum) <= size)
+            {
+                memcpy(&answer_size, data + offset, sizeof(answer_size));
+                memcpy(&checksum, data + offset + sizeof(answer_size), sizeof(checksum));
+                offset += sizeof(answer_size) + sizeof(checksum);
+                if (answer_size > size - offset || answer_checksum(data + offset, answer_size) != checksum)
+                    break;
+                if (answer_size == 0)
+                {
+                    // Commit record, the submission might have been partially saved
+                    committed = true;
+                    break;
+                }
+                if (decode_answer(data + offset, answer_size, &answer) != answer_size) break;
+                offset += answer_size;
+                answer_count++;
+
+                if (answer.is_multiple_choice)
+                {
+                    if (answer.qnum >= 1 && answer.qnum <= exam.qcount) choices[answer.qnum - 1] = answer.chosen;
+                    continue;
+                }
+                Answer essay_answer;
+                memset(&essay_answer, 0, sizeof(essay_answer));
+                strcpy(essay_answer.exam_id, exam.id);
+                strcpy(essay_answer.username, username);
+                essay_answer.qnum = answer.qnum;
+                essay_answer.is_multiple_choice = false;
+                strncpy(essay_answer.essay_answer, answer.essay_answer, sizeof(essay_answer.essay_answer) - 1);
+                essay_answers.push_back(essay_answer);
+            }
+
+            if (!committed && answer_count > 0)
+            {
+                /* The student didn't reach the questions after the last logged answer, the multiple choice ones
+                 * are graded as blank ('x') so they're still counted in the grade
+                 */
+                const QuestionSet *question_set = find_questions(&exam);
+                if (question_set == NULL) return -1;
+                for (unsigned int i = 0; i < exam.qcount && i < question_set->answer_key.size(); i++)
+                {
+                    if (question_set->answer_key[i] != '\0' && choices[i] == '\0') choices[i] = 'x';
+                }
+            }
+            if ((committed || answer_count > 0) &&
+                submit_exam(&exam, username, choices.data(), essay_answers.data(), essay_answers.size(), committed) == -1)
+                return -1;
+        }
+
+        /* Removed while it's still locked, a session of the student starting meanwhile waits for the lock
+         * and then creates a new log (see RecordFile::lock()) instead of writing to the removed one.
+         * Open files can't be removed on Windows, so it's closed first there
+         */
+#ifndef __unix__
+        log_file.close_file();
+#endif
+        remove(log_path);
+    }
+    return 0;
+}
+
+int replay_answer_logs()
+{
+    // Replays the answer logs of all the sessions which didn't end, returns the number of replayed logs
+    vector<string> log_paths;
+    error_code error;
+    for (filesystem::directory_iterator entry("./data", error), end; !error && entry != end; entry.increment(error))
+    {
+        string name = entry->path().filename().string();
+        if (name.size() > 12 && name.compare(0, 8, "session_") == 0 && name.compare(name.size() - 4, 4, ".wal") == 0)
+            log_paths.push_back("./data/" + name);
+    }
+
+    int replayed_count = 0;
+    for (size_t i = 0; i < log_paths.size(); i++)
+    {
+        if (replay_answer_log(log_paths[i].c_str()) == 0) replayed_count++;
+    }
+    return replayed_count;
+}
+
+void generate_exam_id(Exam *exam)
+{
+    // Seeding the generator on the first call
+    static bool generator_seeded = false;
+    if (!generator_seeded)
+    {
+        random_device seed_device;
+        exam_id_generator.seed(((unsigned long long)seed_device() << 32) ^ seed_device() ^ time(NULL));
+        generator_seeded = true;
+    }
+
+    // rand_id_exists() is a lookup in the exams index, so checking for a collision is cheap
+    sync_exams_index();
+    unsigned long long random_id = exam_id_generator();
+    // Converting the number to c-style string
+    strcpy(exam->id, to_string(random_id).c_str());
+    while (rand_id_exists(exam->id))
+    {
+        random_id = exam_id_generator();
+        strcpy(exam->id, to_string(random_id).c_str());
+    }
+}
+
+bool save_exam(const Exam *exam)
+{
+    // Appends the exam to exams.dat and adds it to the indexes
+    RecordFile<Exam> exams_file("./data/exams.dat", true);
+    if (!exams_file.is_open() || exams_file.append(exam) != 1) return false;
+
+    sync_exams_index();
+    update_exams_by_start_index();
+    return true;
+}
+
+bool create_exam_files(const Exam *exam)
+{
+    // Creates the empty results, answers and choices files of a new exam
+    char exam_results_path[MAX_CHAR_ARR_LENGTH];
+    char exam_answers_path[MAX_CHAR_ARR_LENGTH];
+    char exam_choices_path[MAX_CHAR_ARR_LENGTH];
+    create_examR_path(exam_results_path, exam->id);
+    create_examA_path(exam_answers_path, exam->id);
+    create_examC_path(exam_choices_path, exam->id);
+
+    string answers_header(ANSWERS_FILE_MAGIC, sizeof(ANSWERS_FILE_MAGIC));
+    answers_header.append((const char *)&ANSWERS_FILE_VERSION, sizeof(ANSWERS_FILE_VERSION));
+    string choices_header(CHOICES_FILE_MAGIC, sizeof(CHOICES_FILE_MAGIC));
+    choices_header.append((const char *)&exam->qcount, sizeof(exam->qcount));
+
+    return replace_file(exam_results_path, string()) &&
+           replace_file(exam_answers_path, answers_header) &&
+           replace_file(exam_choices_path, choices_header);
+}
+
+ChoiceMatrix::ChoiceMatrix(const char *path) : file(path)
+{
+    qcount = 0;
+    row_size = 0;
+    row_count = 0;
+    if (file.size() < CHOICES_FILE_HEADER_SIZE || memcmp(file.begin(), CHOICES_FILE_MAGIC, sizeof(CHOICES_FILE_MAGIC)) != 0)
+        return;
+
+    memcpy(&qcount, file.begin() + sizeof(CHOICES_FILE_MAGIC), sizeof(qcount));
+    row_size = sizeof(unsigned int) + qcount;
+    // A partially written row at the end of the file is not counted
+    row_count = (file.size() - CHOICES_FILE_HEADER_SIZE) / row_size;
+}
+
+unsigned int ChoiceMatrix::user_num(size_t row) const
+{
+    unsigned int num;
+    memcpy(&num, file.begin() + CHOICES_FILE_HEADER_SIZE + row * row_size, sizeof(num));
+    return num;
+}
+
+AnswerReader::AnswerReader(const char *path) : file(path)
+{
+    compact = file.size() >= ANSWERS_FILE_HEADER_SIZE &&
+              memcmp(file.begin(), ANSWERS_FILE_MAGIC, sizeof(ANSWERS_FILE_MAGIC)) == 0;
+    offset = compact ? ANSWERS_FILE_HEADER_SIZE : 0;
+}
+
+bool AnswerReader::next(AnswerRecord *answer)
+{
+    const char *data = file.begin();
+    size_t size = file.size();
+
+    if (!compact)
+    {
+        // Old format, the fields of the Answer struct are used directly
+        if (offset + sizeof(Answer) > size) return false;
+        const Answer *old_answer = (const Answer *)(data + offset);
+        answer->qnum = old_answer->qnum;
+        answer->is_multiple_choice = old_answer->is_multiple_choice;
+        answer->chosen = old_answer->chosen;
+        answer->username = old_answer->username;
+        answer->essay_answer = old_answer->is_multiple_choice ? "" : old_answer->essay_answer;
+        offset += sizeof(Answer);
+        return true;
+    }
+
+    // A partially written answer at the end of the file is not read
+    size_t answer_size = decode_answer(data + offset, size - offset, answer);
+    if (answer_size == 0) return false;
+    offset += answer_size;
+    return true;
+}
+
+size_t decode_answer(const char *data, size_t size, AnswerRecord *answer)
+{
+    // Reads an answer in the compact format, returns its size or 0 if it's not complete
+    size_t position = 0;
+    if (position + sizeof(answer->qnum) + 2 > size) return 0;
+    memcpy(&answer->qnum, data + position, sizeof(answer->qnum));
+    position += sizeof(answer->qnum);
+    answer->is_multiple_choice = data[position++];
+    unsigned char username_length = data[position++];
+    answer->username = data + position;
+    position += username_length + 1;
+    if (answer->is_multiple_choice)
+    {
+        if (position + 1 > size) return 0;
+        answer->chosen = data[position++];
+        answer->essay_answer = "";
+    }
+    else
+    {
+        unsigned short essay_length;
+        if (position + sizeof(essay_length) > size) return 0;
+        memcpy(&essay_length, data + position, sizeof(essay_length));
+        position += sizeof(essay_length);
+        answer->chosen = '\0';
+        answer->essay_answer = data + position;
+        position += essay_length + 1;
+    }
+    if (position > size) return 0;
+    return position;
+}
+
+AnswerLog::AnswerLog(const char *path, const char *exam_id, const char *username) : path(path), file(path, true)
+{
+    opened = false;
+    unsynced_count = 0;
+    stopping = false;
+    sync_ms = read_env_setting("EMS_WAL_SYNC_MS", WAL_SYNC_MS);
+
+    // The log of another session of the student which is still running, or which has not been replayed yet
+    if (!file.lock(false) || file.size() > 0) return;
+
+    char header[WAL_FILE_HEADER_SIZE] = {};
+    memcpy(header, WAL_FILE_MAGIC, sizeof(WAL_FILE_MAGIC));
+    strcpy(header + sizeof(WAL_FILE_MAGIC), exam_id);
+    strcpy(header + sizeof(WAL_FILE_MAGIC) + MAX_CHAR_ARR_LENGTH, username);
+    opened = file.append(header, sizeof(header)) == sizeof(header);
+    if (opened) sync_thread = thread(&AnswerLog::sync_periodically, this);
+}
+
+AnswerLog::~AnswerLog()
+{
+    stop_syncing();
+}
+
+bool AnswerLog::append(const Answer *answer)
+{
+    if (!opened) return false;
+    string answer_data;
+    encode_answer(answer, &answer_data);
+    unsigned int answer_size = answer_data.size(), checksum = answer_checksum(answer_data.data(), answer_data.size());
+    string record((const char *)&answer_size, sizeof(answer_size));
+    record.append((const char *)&checksum, sizeof(checksum));
+    record += answer_data;
+
+    lock_guard<mutex> file_guard(file_mutex);
+    if (file.append(record.data(), record.size()) != record.size()) return false;
+    unsynced_count++;
+    return true;
+}
+
+bool AnswerLog::commit()
+{
+    if (!opened) return false;
+    unsigned int commit_record[2] = {0, answer_checksum(NULL, 0)};
+    lock_guard<mutex> file_guard(file_mutex);
+    if (file.append((const char *)commit_record, sizeof(commit_record)) != sizeof(commit_record)) return false;
+    unsynced_count = 0;
+    return file.sync();
+}
+
+void AnswerLog::discard()
+{
+    stop_syncing();
+    // Closing first, open files can't be removed on Windows
+    file.close_file();
+    opened = false;
+    remove(path.c_str());
+}
+
+void AnswerLog::sync_periodically()
+{
+    unique_lock<mutex> file_lock(file_mutex);
+    while (!stopping)
+    {
+        stop_condition.wait_for(file_lock, chrono::milliseconds(sync_ms));
+        if (unsynced_count == 0) continue;
+        // Syncing while holding the mutex, so the file isn't appended to or closed meanwhile
+        unsynced_count = 0;
+        file.sync();
+    }
+}
+
+void AnswerLog::stop_syncing()
+{
+    if (!sync_thread.joinable()) return;
+    {
+        lock_guard<mutex> file_guard(file_mutex);
+        stopping = true;
+    }
+    stop_condition.notify_one();
+    sync_thread.join();
+}
+
+MappedFile::MappedFile(const char *path, bool writable, size_t record_size)
+    : path(path), writable(writable), record_size(record_size)
+{
+    lock_depth = 0;
+    open_file();
+}
+
+MappedFile::~MappedFile()
+{
+    close_file();
+}
+
+void MappedFile::open_file()
+{
+    opened = false;
+    bytes = NULL;
+    count = 0;
+#ifdef __unix__
+    mapped_size = 0;
+    fd = open(path.c_str(), writable ? O_RDWR | O_CREAT | O_APPEND : O_RDONLY, 0644);
+    if (fd == -1) return;
+    opened = true;
+    metric_counters.file_opens++;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0) map_records(file_stat.st_size);
+#else
+    buffer.clear();
+    file_ptr = fopen(path.c_str(), writable ? "a+b" : "rb");
+    if (file_ptr == NULL) return;
+    opened = true;
+    metric_counters.file_opens++;
+
+    fseek(file_ptr, 0, SEEK_END);
+    map_records(ftell(file_ptr));
+#endif
+}
+
+void MappedFile::close_file()
+{
+#ifdef __unix__
+    if (mapped_size > 0) munmap((void *)bytes, mapped_size);
+    if (fd != -1) close(fd);
+    mapped_size = 0;
+    fd = -1;
+#else
+    if (file_ptr != NULL) fclose(file_ptr);
+    file_ptr = NULL;
+#endif
+    opened = false;
+    bytes = NULL;
+    count = 0;
+}
+
+void MappedFile::map_records(size_t file_size)
+{
+    // A partially written record at the end of the file is not counted
+    size_t new_count = file_size / record_size;
+#ifdef __unix__
+    if (new_count * record_size > mapped_size)
+    {
+        if (mapped_size > 0) munmap((void *)bytes, mapped_size);
+        /* Mapping twice the file size, so appending records doesn't need a new mapping every time
+         * (pages after the end of the file are never accessed)
+         */
+        mapped_size = new_count * record_size * 2;
+        void *mapping = mmap(NULL, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED)
+        {
+            mapped_size = 0;
+            bytes = NULL;
+            count = 0;
+            return;
+        }
+        bytes = (const char *)mapping;
+    }
+#else
+    // Reading the records which are not in the buffer yet
+    size_t old_count = buffer.size() / record_size;
+    if (new_count > old_count)
+    {
+        buffer.resize(new_count * record_size);
+        fseek(file_ptr, old_count * record_size, SEEK_SET);
+        new_count = old_count + fread(&buffer[old_count * record_size], record_size, new_count - old_count, file_ptr);
+        buffer.resize(new_count * record_size);
+    }
+    bytes = buffer.empty() ? NULL : &buffer[0];
+#endif
+    if (new_count > count)
+    {
+        metric_counters.records_mapped += new_count - count;
+        metric_counters.bytes_mapped += (new_count - count) * record_size;
+    }
+    count = new_count;
+}
+
+bool MappedFile::lock(bool wait)
+{
+    if (!opened) return false;
+    if (lock_depth++ > 0) return true;
+#ifdef __unix__
+    while (true)
+    {
+        if (flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB) != 0)
+        {
+            if (errno == EINTR) continue;
+            lock_depth = 0;
+            return false;
+        }
+
+        /* The file might have been replaced by replace_file() or removed (a replayed answer log) while waiting
+         * for the lock, in that case the file now at path is opened (or created) and locked instead,
+         * so no records are written to the old one
+         */
+        struct stat file_stat, path_stat;
+        if (fstat(fd, &file_stat) != 0) break;
+        if (stat(path.c_str(), &path_stat) == 0 && file_stat.st_dev == path_stat.st_dev &&
+            file_stat.st_ino == path_stat.st_ino)
+        {
+            map_records(file_stat.st_size);
+            break;
+        }
+        close_file();
+        open_file();
+        if (!opened)
+        {
+            lock_depth = 0;
+            return false;
+        }
+    }
+#elif _WIN32
+    /* Locking a byte far after the end of the file, Windows locks are mandatory so locking the
+     * records themselves would make other processes fail to read them
+     */
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = 0xFFFFFFFF;
+    overlapped.OffsetHigh = 0x7FFFFFFF;
+    DWORD lock_flags = wait ? LOCKFILE_EXCLUSIVE_LOCK : LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY;
+    if (!LockFileEx((HANDLE)_get_osfhandle(_fileno(file_ptr)), lock_flags, 0, 1, 0, &overlapped))
+    {
+        lock_depth = 0;
+        return false;
+    }
+    fseek(file_ptr, 0, SEEK_END);
+    map_records(ftell(file_ptr));
+#endif
+    return true;
+}
+
+bool MappedFile::sync()
+{
+    if (!opened) return false;
+#ifdef __unix__
+    return fsync(fd) == 0;
+#elif _WIN32
+    return fflush(file_ptr) == 0 && _commit(_fileno(file_ptr)) == 0;
+#else
+    return fflush(file_ptr) == 0;
+#endif
+}
+
+bool MappedFile::replace(const string &data)
+{
+#ifndef __unix__
+    close_file();
+    lock_depth = 0;
+#endif
+    return replace_file(path.c_str(), data);
+}
+
+void MappedFile::unlock()
+{
+    if (!opened || lock_depth == 0 || --lock_depth > 0) return;
+#ifdef __unix__
+    flock(fd, LOCK_UN);
+#elif _WIN32
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = 0xFFFFFFFF;
+    overlapped.OffsetHigh = 0x7FFFFFFF;
+    UnlockFileEx((HANDLE)_get_osfhandle(_fileno(file_ptr)), 0, 1, 0, &overlapped);
+#endif
+}
+
+size_t MappedFile::append(const char *data, size_t size)
+{
+    if (!lock(true)) return 0;
+#ifdef __unix__
+    // The file is opened with O_APPEND, so the records are always written at the end of it
+    size_t written_size = 0;
+    while (written_size < size)
+    {
+        ssize_t written_now = write(fd, data + written_size, size - written_size);
+        if (written_now <= 0) break;
+        written_size += written_now;
+    }
+
+    // Growing the mapping (the file might have been grown by other processes too)
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0) map_records(file_stat.st_size);
+    unlock();
+    return written_size;
+#else
+    fseek(file_ptr, 0, SEEK_END);
+    size_t written_size = fwrite(data, 1, size, file_ptr);
+    fflush(file_ptr);
+    map_records(ftell(file_ptr));
+    unlock();
+    return written_size;
+#endif
+}
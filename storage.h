@@ -0,0 +1,535 @@
+/* EMS storage engine
+ * The data files of EMS (./data) and everything done with them: users, exams, questions, answers,
+ * results and enrollments, their indexes, grading and submitting exams, the answer logs of exam sessions
+ * and the EMS server (server.cpp). Apart from the status messages of the server, nothing here reads from or
+ * writes to the console, the console UI (console.h), the commands (main.cpp) and the benchmark (bench.cpp)
+ * are built on these functions.
+ */
+#ifndef EMS_STORAGE_H
+#define EMS_STORAGE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+const unsigned int MAX_CHAR_ARR_LENGTH = 128;
+
+struct User
+{
+    // First name
+    char fname[MAX_CHAR_ARR_LENGTH];
+    // Last name
+    char lname[MAX_CHAR_ARR_LENGTH];
+    // Username (unique among all users (studnets, professors and manager))
+    char username[MAX_CHAR_ARR_LENGTH];
+    // Password (Must be at least 8 characters)
+    char password[MAX_CHAR_ARR_LENGTH];
+    // User role
+    // * 'M' => Manager
+    // * 'P' => Professor
+    // * 'S' => Student
+    char role;
+};
+
+struct Exam
+{
+    // Exam ID is a randomly generated unique number
+    char id[MAX_CHAR_ARR_LENGTH];
+    // Exam name e.g. "Fundamental Programming Semester Exam"
+    char name[MAX_CHAR_ARR_LENGTH];
+    // Username of the creator (which is the professor who created it)
+    // * The results of this exam will only be available to the corresponding professor
+    char creator_username[MAX_CHAR_ARR_LENGTH];
+    // Number of questions in the exam
+    unsigned int qcount;
+    // Start time of the exam in seconds since 00:00 hours, Jan 1, 1970 UTC (UNIX Timestamp)
+    time_t start_time;
+    // End time of the exam in seconds since 00:00 hours, Jan 1, 1970 UTC (UNIX Timestamp)
+    time_t end_time;
+};
+
+struct Question
+{
+    /* true: the question is a multiple choice question
+     * will be asked for 4 options (Question::opt1, ..., Question::opt4)
+     * and a correct option (Question::correct)
+     * false: the question is an essay question
+     * the answer to these type of questions will be stored in Answer::essay_answer
+     */
+    bool is_multiple_choice;
+    // Question number
+    unsigned int qnum;
+    // The question itself
+    char question[MAX_CHAR_ARR_LENGTH];
+    // Four options for multiple choice questions
+    char opt1[MAX_CHAR_ARR_LENGTH];
+    char opt2[MAX_CHAR_ARR_LENGTH];
+    char opt3[MAX_CHAR_ARR_LENGTH];
+    char opt4[MAX_CHAR_ARR_LENGTH];
+    /* The correct option character
+     * 'a', 'b', 'c', 'd'
+     */
+    char correct;
+};
+
+struct Answer
+{
+    // Exam ID of the exam which this answer is related to
+    char exam_id[MAX_CHAR_ARR_LENGTH];
+    // Username of the student whome this answer belongs to
+    char username[MAX_CHAR_ARR_LENGTH];
+    // Question number corresponding to this answer
+    unsigned int qnum;
+    // To determine if this answer is an answer to a multiple choice question or not
+    bool is_multiple_choice;
+    // Option choosed by the student if is_multiple_choise is true
+    char chosen;
+    // Answer to an essay question if is_multiple_choise is false
+    char essay_answer[512];
+};
+
+struct Result
+{
+    // Username of the student whome this result belongs to
+    char username[MAX_CHAR_ARR_LENGTH];
+    // ID of an exam which this result belongs to
+    char exam_id[MAX_CHAR_ARR_LENGTH];
+    // Name of the exam which this result belongs to
+    char exam_name[MAX_CHAR_ARR_LENGTH];
+    // Number of correctly answered multiple choice questions
+    int correct_choices_count;
+    // Number of wrongly answered multiple choice questions
+    int wrong_choices_count;
+    // Total number of multiple choice questions
+    int multiple_choice_count;
+    /* Calculated score in percent
+     * Each question has 3 scores 
+     * 3 scores is given for a correct answer
+     * 1 score is taken for a wrong answer
+     * 0 score for a blank answer
+     */
+    float multiple_choice_percent;
+    /* The time which the result will be visible by a user
+     * Which is the end time of the corresponding exam (Exam::end_time)
+    */
+    time_t visible_time;
+};
+
+/* The bytes of a data file, read as records of record_size bytes (see RecordFile)
+ * On unix the file is memory-mapped, so reading it doesn't copy the records or call fread for each of them.
+ * On other systems the whole file is read into memory at once.
+ * The platform specific code is in storage.cpp, so the header doesn't include the system headers.
+ */
+class MappedFile
+{
+public:
+    MappedFile(const char *path, bool writable, size_t record_size);
+    ~MappedFile();
+
+    bool is_open() const { return opened; }
+    const char *data() const { return bytes; }
+    // Number of complete records in the file
+    size_t record_count() const { return count; }
+    // Writes size bytes at the end of the file, returns the number of bytes written
+    size_t append(const char *data, size_t size);
+    bool lock(bool wait);
+    void unlock();
+    bool sync();
+    bool replace(const std::string &data);
+    void close_file();
+
+private:
+    // Mapped files are not copyable (the mapping belongs to one object)
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+    void open_file();
+    void map_records(size_t file_size);
+
+    std::string path;
+    bool writable;
+    size_t record_size;
+    bool opened;
+    int lock_depth;
+    const char *bytes;
+    size_t count;
+#ifdef __unix__
+    int fd;
+    size_t mapped_size;
+#else
+    FILE *file_ptr;
+    std::vector<char> buffer;
+#endif
+};
+
+/* A .dat file of fixed-size records (User, Exam, Question, Answer, Result, ...)
+ * The records are exposed as an array of the mapped file (see MappedFile).
+ * New records are written at the end of the file by append(), the mapping grows to include them.
+ * Several EMS processes can share ./data, so writes are done while holding an exclusive advisory lock
+ * on the file (flock on unix, LockFileEx on Windows).
+ */
+template <typename T>
+class RecordFile
+{
+public:
+    // writable: the file is created if it doesn't exist and records can be appended to it
+    RecordFile(const char *path, bool writable = false) : file(path, writable, sizeof(T)) {}
+
+    bool is_open() const { return file.is_open(); }
+    // Number of complete records in the file
+    size_t size() const { return file.record_count(); }
+    const T &operator[](size_t i) const { return begin()[i]; }
+    const T *begin() const { return (const T *)file.data(); }
+    const T *end() const { return begin() + size(); }
+
+    /* Writes new records at the end of the file, returns the number of records written
+     * The file is locked during the write, so records of other processes are never interleaved with them.
+     */
+    size_t append(const T *new_records, size_t new_count = 1)
+    {
+        return file.append((const char *)new_records, new_count * sizeof(T)) / sizeof(T);
+    }
+
+    /* Locks the file, other processes wait in lock() (or append()) until the file is unlocked
+     * After locking, the records include everything appended by other processes so far.
+     * Only needed when a check and a write must happen together (e.g. checking a username before
+     * appending the user), locks can be nested.
+     * wait: if false, returns false right away when another process has locked the file
+     */
+    bool lock(bool wait = true) { return file.lock(wait); }
+    void unlock() { file.unlock(); }
+    // Makes sure the appended records are written to the disk (fsync), not only to the OS cache
+    bool sync() { return file.sync(); }
+    /* Replaces the file with data (see replace_file()), on unix the file stays locked until it's unlocked,
+     * so processes waiting for the lock lock the new file. Open files can't be replaced on Windows, there
+     * the file is closed first and the replacement fails while another process has the file open.
+     */
+    bool replace(const std::string &data) { return file.replace(data); }
+    void close_file() { file.close_file(); }
+
+private:
+    MappedFile file;
+};
+
+/* Compact (version 2) format of the exam_<id>_answers.dat files
+ * The file starts with ANSWERS_FILE_MAGIC and ANSWERS_FILE_VERSION (4 bytes), followed by the answers:
+ * [qnum: 4 bytes][is_multiple_choice: 1 byte][username length: 1 byte][username + '\0']
+ * then [chosen: 1 byte] for a multiple choice answer, or
+ * [essay length: 2 bytes][essay_answer + '\0'] for an essay answer.
+ * Answer::exam_id is not stored since it's already in the file name.
+ * Files without the magic are in the old format (array of Answer structs), "ems migrate" converts them.
+ */
+const char ANSWERS_FILE_MAGIC[4] = {'E', 'M', 'S', 'A'};
+const unsigned int ANSWERS_FILE_VERSION = 2;
+const size_t ANSWERS_FILE_HEADER_SIZE = sizeof(ANSWERS_FILE_MAGIC) + sizeof(ANSWERS_FILE_VERSION);
+
+// An answer read from an answers file, the strings point into the mapping of the file
+struct AnswerRecord
+{
+    unsigned int qnum;
+    bool is_multiple_choice;
+    char chosen;
+    const char *username;
+    const char *essay_answer;
+};
+
+// Reads the answers of an exam_<id>_answers.dat file in either the compact or the old format
+class AnswerReader
+{
+public:
+    AnswerReader(const char *path);
+
+    bool is_open() const { return file.is_open(); }
+    // false if the file is in the old format
+    bool is_compact() const { return compact; }
+    size_t file_size() const { return file.size(); }
+    // Position of the next answer in the file, can be passed to seek() to read the answer again
+    size_t tell() const { return offset; }
+    void seek(size_t position) { offset = position; }
+    // Reads the next answer, returns false at the end of the file
+    bool next(AnswerRecord *answer);
+    void close_file() { file.close_file(); }
+
+private:
+    RecordFile<char> file;
+    bool compact;
+    size_t offset;
+};
+
+/* Multiple choice answers of an exam (exam_<id>_choices.dat), stored as a student x question matrix
+ * The file starts with CHOICES_FILE_MAGIC and the number of questions of the exam (4 bytes),
+ * followed by one row per student who took the exam:
+ * [record number of the student in users.dat: 4 bytes][one byte per question]
+ * The byte of a question is the chosen option ('a'-'d', or 'x' for blank), or '\0' for essay questions
+ * and questions which were not answered. Essay answers are kept in exam_<id>_answers.dat.
+ */
+const char CHOICES_FILE_MAGIC[4] = {'E', 'M', 'S', 'C'};
+const size_t CHOICES_FILE_HEADER_SIZE = sizeof(CHOICES_FILE_MAGIC) + sizeof(unsigned int);
+
+class ChoiceMatrix
+{
+public:
+    ChoiceMatrix(const char *path);
+
+    bool is_open() const { return qcount > 0; }
+    unsigned int question_count() const { return qcount; }
+    // Number of students (rows)
+    size_t size() const { return row_count; }
+    // Record number in users.dat of the student of the row
+    unsigned int user_num(size_t row) const;
+    // The chosen options of the row, one byte per question (question #qnum is at qnum - 1)
+    const char *choices(size_t row) const { return file.begin() + CHOICES_FILE_HEADER_SIZE + row * row_size + sizeof(unsigned int); }
+    void close_file()
+    {
+        file.close_file();
+        row_count = 0;
+    }
+
+private:
+    RecordFile<char> file;
+    unsigned int qcount;
+    size_t row_size;
+    size_t row_count;
+};
+
+/* Write-ahead log of the answers of an exam session (./data/session_<exam id>_<username>.wal)
+ * Every answer is written to the log as soon as it's entered, so if EMS crashes or the terminal is closed
+ * during the exam, the next EMS startup submits the logged answers (replay_answer_logs()).
+ * Writing an answer doesn't wait for fsync, a background thread of the session syncs the log every WAL_SYNC_MS
+ * milliseconds if answers were written since the last sync (so an answer reaches the disk at most WAL_SYNC_MS
+ * after it's entered), and the log is synced when the exam is submitted.
+ * The EMS_WAL_SYNC_MS environment variable overrides the interval.
+ * The log starts with WAL_FILE_MAGIC, the exam ID and the username (MAX_CHAR_ARR_LENGTH bytes each),
+ * followed by the answers: [answer size: 4 bytes][checksum: 4 bytes][answer in the compact format]
+ * An answer with a wrong checksum (partially written before a crash) and everything after it is ignored.
+ * When the exam is submitted, a commit record (answer size 0) is written and synced together with the
+ * last answers before any exam file is touched, so a submission interrupted by a crash is completed
+ * by the replay (see submit_exam()), without syncing the exam files themselves.
+ */
+const char WAL_FILE_MAGIC[4] = {'E', 'M', 'S', 'W'};
+const size_t WAL_FILE_HEADER_SIZE = sizeof(WAL_FILE_MAGIC) + 2 * MAX_CHAR_ARR_LENGTH;
+const unsigned int WAL_SYNC_MS = 2000;
+
+class AnswerLog
+{
+public:
+    /* Starts the log of a new session at path (see create_session_log_path())
+     * The log stays locked until the session ends, so it's not replayed while the session is running
+     */
+    AnswerLog(const char *path, const char *exam_id, const char *username);
+    ~AnswerLog();
+
+    // false if the log couldn't be created, or the session is running on another terminal
+    bool is_open() const { return opened; }
+    // Writes the answer to the log, it's synced by the sync thread
+    bool append(const Answer *answer);
+    // Marks the session as submitted and syncs the log, called before the answers are saved to the exam files
+    bool commit();
+    // Removes the log after its answers are submitted
+    void discard();
+
+private:
+    AnswerLog(const AnswerLog &);
+    AnswerLog &operator=(const AnswerLog &);
+    // Body of sync_thread, syncs the log every sync_ms milliseconds until stop_syncing() is called
+    void sync_periodically();
+    void stop_syncing();
+
+    std::string path;
+    RecordFile<char> file;
+    bool opened;
+    unsigned int sync_ms;
+    // file and unsynced_count are shared with sync_thread, they're only accessed while holding file_mutex
+    std::mutex file_mutex;
+    unsigned int unsynced_count;
+    bool stopping;
+    std::condition_variable stop_condition;
+    std::thread sync_thread;
+};
+
+/* In-memory index of ./data/users.dat
+ * users_table holds every User struct in file order and users_index maps a username to its
+ * position in users_table, so looking a user up doesn't need to scan the file.
+ * The index is synced by reading only the records appended after the last sync
+ * (by this or by another EMS process).
+ */
+extern std::vector<User> users_table;
+extern std::unordered_map<std::string, size_t> users_index;
+
+struct ExamIndexEntry
+{
+    // Numeric value of Exam::id
+    unsigned long long id;
+    // Position of the exam in ./data/exams.dat (in number of Exam structs)
+    unsigned int record_num;
+};
+
+/* Index of ./data/exams.dat
+ * exams_index maps the numeric exam ID to the position of the exam in exams.dat.
+ * The entries are also persisted in ./data/exams.idx (array of ExamIndexEntry structs), so on
+ * startup the index is loaded from that small file instead of reading every exam of the catalog.
+ * exams_indexed_count is the number of exams.dat records which are indexed and
+ * exams_idx_read_count is the number of exams.idx entries which are already loaded.
+ */
+extern std::unordered_map<unsigned long long, unsigned int> exams_index;
+extern unsigned int exams_indexed_count;
+extern size_t exams_idx_read_count;
+
+struct ExamStartEntry
+{
+    // Exam::start_time of the exam
+    time_t start_time;
+    // Position of the exam in ./data/exams.dat (in number of Exam structs)
+    unsigned int record_num;
+};
+
+/* Sorted secondary indexes of the catalog, used for listing users and exams without sorting them
+ * ./data/users_by_lname.idx: positions of the users in users.dat (unsigned int), sorted by User::lname
+ * ./data/exams_by_start.idx: ExamStartEntry of each exam in exams.dat, sorted by Exam::start_time
+ * Users and exams with the same key are in the order they were added.
+ * The index file of a file with n records has the records 0 to m-1 (m <= n), the records after them are the
+ * unsorted tail of the index (added since the last merge, by an older version of EMS, or by a process which
+ * stopped before updating the index). Loading the index (load_users_by_lname(), load_exams_by_start()) sorts
+ * the tail in memory and merges it with the index file, and the tail is merged into the index file once it
+ * has SORTED_INDEX_TAIL_LIMIT records, so adding a user or an exam doesn't rewrite the whole index.
+ */
+const char USERS_BY_LNAME_INDEX_PATH[] = "./data/users_by_lname.idx";
+const char EXAMS_BY_START_INDEX_PATH[] = "./data/exams_by_start.idx";
+const size_t SORTED_INDEX_TAIL_LIMIT = 256;
+
+struct Enrollment
+{
+    // Position of the student in ./data/users.dat (in number of User structs)
+    unsigned int user_num;
+    // Numeric value of the ID of the exam which the student has taken
+    unsigned long long exam_id;
+};
+
+/* Index of ./data/enrollments.dat (array of Enrollment structs), the exams taken by each student
+ * It replaces the old per-student ./data/map_<username>.dat files ("ems migrate" converts them).
+ * exams_of_student is used for checking whether a student has taken an exam.
+ * The index is synced like the users index, by reading only the enrollments appended after the last sync.
+ */
+extern std::unordered_map<unsigned int, std::unordered_set<unsigned long long>> exams_of_student;
+extern size_t enrollments_read_count;
+
+/* Question sets of the exams, kept for the rest of the process (see find_questions())
+ * A set is the whole questions file of an exam, read at once through the shared mapping of the file,
+ * so the file is read from the disk once no matter how many EMS processes load it, and its answer key.
+ * The EMS server prefetches the sets of the exams starting in the next QUESTIONS_PREFETCH_SECONDS,
+ * so the students starting an exam together are served from memory, and drops the sets of ended exams.
+ * A set is read again when its questions file has been replaced (answer key corrected).
+ */
+const time_t QUESTIONS_PREFETCH_SECONDS = 15 * 60;
+
+struct QuestionSet
+{
+    std::vector<Question> questions;
+    // Correct option of each question (see load_answer_key())
+    std::vector<char> answer_key;
+    // Exam::end_time of the exam
+    time_t end_time;
+    // The questions file which was read, to notice when it's replaced
+    unsigned long long device;
+    unsigned long long inode;
+    long long size;
+    time_t modified_time;
+};
+
+/* EMS server ("ems serve")
+ * One process keeps the users, exams and questions in memory and serves the other EMS processes of the
+ * machine over a Unix domain socket, so they don't read the .dat files for logging in and taking exams.
+ * Requests and responses are [payload size: 4 bytes][payload]. The payload of a request starts with
+ * its command and the payload of a response with its status:
+ * 'L' [username + '\0'][password + '\0'] -> the User struct (without the password)
+ * 'E' [exam ID + '\0'] -> the Exam struct
+ * 'Q' [exam ID + '\0'] -> the Question structs of the exam
+ * 'S' [exam ID + '\0'][qcount: 4 bytes][chosen options][essay count: 4 bytes][Answer structs]
+ *     -> saves the answers of the logged in student (see submit_exam())
+ */
+const char SERVER_SOCKET_PATH[] = "./data/ems.sock";
+const char SERVER_OK = 0;
+const char SERVER_NOT_FOUND = 1;
+const char SERVER_ALREADY_TAKEN = 2;
+const char SERVER_ERROR = 3;
+
+/* Counters of the file reads, kept for the metrics of the user facing operations (see OperationTimer)
+ * RecordFile adds to them, the console adds the time spent waiting for input and the size of its output.
+ */
+struct MetricCounters
+{
+    // Files opened by RecordFile
+    unsigned long long file_opens;
+    /* Records made available by RecordFile when the file is opened or grows (mapped on unix, read into
+     * memory on other systems) and their size, whether or not they're accessed afterwards
+     * The answers and choices files are mapped as records of one byte.
+     */
+    unsigned long long records_mapped;
+    unsigned long long bytes_mapped;
+    // Bytes written to the terminal by show_pages()
+    unsigned long long output_bytes;
+    // Time spent waiting for the user's input, in microseconds
+    double input_wait_us;
+};
+extern MetricCounters metric_counters;
+
+const User *authenticate_user(const char *username, const char *password);
+bool username_exists(char *username);
+void sync_users_index();
+const User *find_user(const char *username);
+const User *lookup_user(const char *username);
+long find_user_record(const char *username);
+bool rand_id_exists(char *rand_id);
+bool parse_exam_id(const char *exam_id, unsigned long long *id_num);
+void sync_exams_index();
+long find_exam_record(const char *exam_id);
+bool find_exam(const char *exam_id, Exam *exam);
+void sync_enrollments();
+bool has_taken_exam(const char *username, const char *exam_id);
+bool add_enrollment(const char *username, const char *exam_id);
+void update_users_by_lname_index();
+void update_exams_by_start_index();
+void load_users_by_lname(std::vector<unsigned int> *sorted_users);
+void load_exams_by_start(std::vector<ExamStartEntry> *sorted_entries);
+bool create_data_directory();
+void create_examQ_path(char *exam_path, const char *exam_id);
+void create_examA_path(char *exam_path, const char *exam_id);
+void create_examR_path(char *exam_path, const char *exam_id);
+void create_examC_path(char *exam_path, const char *exam_id);
+void create_session_log_path(char *log_path, const char *exam_id, const char *username);
+void encode_answer(const Answer *answer, std::string *buffer);
+size_t decode_answer(const char *data, size_t size, AnswerRecord *answer);
+bool append_answers(const char *answers_path, const Answer *answers, size_t count);
+bool append_choices(const char *choices_path, unsigned int qcount, unsigned int user_num, const char *choices);
+bool replace_file(const char *path, const std::string &data);
+void load_answer_key(const Question *questions, size_t question_count, unsigned int qcount, std::vector<char> *key);
+void grade_choices(const char *key, const char *choices, unsigned int qcount, Result *result);
+int regrade_exam(const char *exam_id);
+void calculate_score(Result *result);
+int change_answer_key(const char *exam_id, unsigned int qnum, char new_correct);
+bool load_questions(const Exam *exam, std::vector<Question> *questions);
+const QuestionSet *find_questions(const Exam *exam);
+int prefetch_questions(time_t from, time_t until);
+void release_questions(time_t ended_before);
+int submit_exam(const Exam *exam, const char *username, const char *choices, const Answer *essay_answers,
+                size_t essay_count, bool resume = false);
+void run_server();
+bool connect_to_server();
+bool server_request(const std::string &request, std::string *response);
+bool server_submit_exam(const Exam *exam, const char *choices, const std::vector<Answer> &essay_answers, int *submit_status);
+unsigned int answer_checksum(const char *data, size_t size);
+unsigned int read_env_setting(const char *name, unsigned int default_value);
+int replay_answer_log(const char *log_path);
+int replay_answer_logs();
+void generate_exam_id(Exam *exam);
+bool save_exam(const Exam *exam);
+bool create_exam_files(const Exam *exam);
+
+#endif
@@ -0,0 +1,387 @@
+/* EMS tests ("ems_test")
+ * Checks grading, the compact answers format, answer log replays, regrading and the index lookups of the storage engine.
+ * The data is generated in TEST_DIRECTORY, which is removed afterwards.
+ */
+#include "storage.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+const char TEST_DIRECTORY[] = "test-data";
+// More users and exams than SORTED_INDEX_TAIL_LIMIT, so the index files are merged at least once
+const unsigned int TEST_USER_COUNT = 600;
+const unsigned int TEST_EXAM_COUNT = 300;
+
+// Number of failed checks
+unsigned int failed_count = 0;
+
+#define CHECK(condition)                                                               \
+    do                                                                                 \
+    {                                                                                  \
+        if (!(condition))                                                              \
+        {                                                                              \
+            cout << __FILE__ << ':' << __LINE__ << ": check failed: " #condition "\n"; \
+            failed_count++;                                                            \
+        }                                                                              \
+    } while (false)
+
+void test_grading();
+void test_answer_encoding();
+void test_indexes();
+void test_answer_log_replay();
+void test_regrade_old_answers();
+void add_test_user(const char *username, const char *lname, char role);
+bool add_test_exam(Exam *exam, unsigned int qcount, time_t start_time, const char *correct_options);
+
+int main()
+{
+    error_code error;
+    filesystem::path working_directory = filesystem::current_path(error);
+    filesystem::remove_all(TEST_DIRECTORY, error);
+    filesystem::create_directory(TEST_DIRECTORY, error);
+    if (!error) filesystem::current_path(TEST_DIRECTORY, error);
+    if (error || !create_data_directory())
+    {
+        cout << "*** Error: Couldn't run the tests, check the permission to write into ./" << TEST_DIRECTORY << ". ***\n";
+        return 1;
+    }
+
+    test_grading();
+    test_answer_encoding();
+    test_indexes();
+    test_answer_log_replay();
+    test_regrade_old_answers();
+
+    filesystem::current_path(working_directory, error);
+    filesystem::remove_all(TEST_DIRECTORY, error);
+    if (failed_count > 0)
+    {
+        cout << failed_count << " checks failed\n";
+        return 1;
+    }
+    cout << "All tests passed\n";
+    return 0;
+}
+
+void test_grading()
+{
+    // grade_choices() against a plain loop, for counts covering the AVX2, SSE2 and scalar parts of it
+    mt19937 generator(2022);
+    for (unsigned int row = 0; row < 1000; row++)
+    {
+        unsigned int qcount = row % 101;
+        vector<char> key(qcount), choices(qcount);
+        int answered_count = 0, correct_count = 0, blank_count = 0;
+        for (unsigned int i = 0; i < qcount; i++)
+        {
+            // '\0' in the key is an essay question, and in the choices an unanswered one (half of the answers are correct)
+            key[i] = generator() % 5 == 0 ? '\0' : "abcd"[generator() % 4];
+            if (key[i] == '\0')
+                choices[i] = '\0';
+            else
+                choices[i] = generator() % 2 == 0 ? key[i] : "abcdx"[generator() % 5];
+            if (choices[i] == '\0') continue;
+            answered_count++;
+            if (choices[i] == key[i])
+                correct_count++;
+            else if (choices[i] == 'x')
+                blank_count++;
+        }
+
+        Result result;
+        grade_choices(key.data(), choices.data(), qcount, &result);
+        CHECK(result.multiple_choice_count == answered_count);
+        CHECK(result.correct_choices_count == correct_count);
+        CHECK(result.wrong_choices_count == answered_count - correct_count - blank_count);
+    }
+
+    // 2 correct, 1 wrong and 1 blank answer: (3 * 2 - 1) / (3 * 4) = 41.67%
+    Result result;
+    grade_choices("abcd", "abdx", 4, &result);
+    CHECK(result.correct_choices_count == 2 && result.wrong_choices_count == 1);
+    CHECK(fabs(result.multiple_choice_percent - 500.0f / 12) < 0.01);
+    // An exam without multiple choice questions
+    grade_choices("", "", 0, &result);
+    CHECK(result.multiple_choice_percent == 100);
+}
+
+void test_answer_encoding()
+{
+    Answer answers[2];
+    memset(answers, 0, sizeof(answers));
+    strcpy(answers[0].username, "student");
+    answers[0].qnum = 3;
+    answers[0].is_multiple_choice = true;
+    answers[0].chosen = 'c';
+    strcpy(answers[1].username, "another_student");
+    answers[1].qnum = 70000;
+    answers[1].is_multiple_choice = false;
+    strcpy(answers[1].essay_answer, "An essay answer");
+
+    string data;
+    encode_answer(&answers[0], &data);
+    size_t first_size = data.size();
+    encode_answer(&answers[1], &data);
+    // The compact format stores only the used part of the strings
+    CHECK(data.size() < sizeof(Answer));
+
+    AnswerRecord answer;
+    CHECK(decode_answer(data.data(), data.size(), &answer) == first_size);
+    CHECK(answer.qnum == 3 && answer.is_multiple_choice && answer.chosen == 'c');
+    CHECK(strcmp(answer.username, "student") == 0);
+    CHECK(decode_answer(data.data() + first_size, data.size() - first_size, &answer) == data.size() - first_size);
+    CHECK(answer.qnum == 70000 && !answer.is_multiple_choice);
+    CHECK(strcmp(answer.username, "another_student") == 0);
+    CHECK(strcmp(answer.essay_answer, "An essay answer") == 0);
+
+    // A partially written answer is not decoded
+    for (size_t size = 0; size < data.size() - first_size; size++)
+        CHECK(decode_answer(data.data() + first_size, size, &answer) == 0);
+}
+
+void test_indexes()
+{
+    mt19937 generator(2022);
+    char username[MAX_CHAR_ARR_LENGTH], lname[MAX_CHAR_ARR_LENGTH];
+    for (unsigned int i = 0; i < TEST_USER_COUNT; i++)
+    {
+        snprintf(username, sizeof(username), "user%u", i);
+        snprintf(lname, sizeof(lname), "Last%u", (unsigned int)(generator() % 100));
+        add_test_user(username, lname, 'S');
+        // The index is updated after every user, like after registering a user
+        update_users_by_lname_index();
+    }
+
+    sync_users_index();
+    CHECK(users_table.size() == TEST_USER_COUNT);
+    CHECK(find_user_record("user0") == 0);
+    CHECK(find_user_record("user123") == 123);
+    CHECK(lookup_user("user123") != NULL && strcmp(lookup_user("user123")->username, "user123") == 0);
+    CHECK(find_user_record("nobody") == -1);
+
+    // Every user exactly once, sorted by last name and then in the order they were added
+    vector<unsigned int> sorted_users;
+    load_users_by_lname(&sorted_users);
+    CHECK(sorted_users.size() == TEST_USER_COUNT);
+    for (size_t i = 1; i < sorted_users.size(); i++)
+    {
+        int order = strcmp(users_table[sorted_users[i - 1]].lname, users_table[sorted_users[i]].lname);
+        CHECK(order < 0 || (order == 0 && sorted_users[i - 1] < sorted_users[i]));
+    }
+    // An index with users which are not in users_table is not used
+    vector<unsigned int> bad_index(TEST_USER_COUNT + 1);
+    for (unsigned int i = 0; i < bad_index.size(); i++)
+        bad_index[i] = bad_index.size() - 1 - i;
+    CHECK(replace_file(USERS_BY_LNAME_INDEX_PATH,
+                       string((const char *)bad_index.data(), bad_index.size() * sizeof(unsigned int))));
+    vector<unsigned int> resorted_users;
+    load_users_by_lname(&resorted_users);
+    CHECK(resorted_users == sorted_users);
+
+    vector<Exam> exams(TEST_EXAM_COUNT);
+    for (unsigned int i = 0; i < TEST_EXAM_COUNT; i++)
+        CHECK(add_test_exam(&exams[i], 1, 1000000 + generator() % 1000, "a"));
+
+    Exam exam;
+    for (unsigned int i = 0; i < TEST_EXAM_COUNT; i += 37)
+    {
+        CHECK(find_exam(exams[i].id, &exam));
+        CHECK(strcmp(exam.id, exams[i].id) == 0 && exam.start_time == exams[i].start_time);
+    }
+    CHECK(!find_exam("123", &exam));
+    CHECK(!find_exam("not a number", &exam));
+
+    vector<ExamStartEntry> sorted_entries;
+    load_exams_by_start(&sorted_entries);
+    CHECK(sorted_entries.size() == TEST_EXAM_COUNT);
+    vector<bool> listed(TEST_EXAM_COUNT, false);
+    for (size_t i = 0; i < sorted_entries.size(); i++)
+    {
+        if (i > 0) CHECK(sorted_entries[i - 1].start_time <= sorted_entries[i].start_time);
+        if (sorted_entries[i].record_num < TEST_EXAM_COUNT) listed[sorted_entries[i].record_num] = true;
+    }
+    CHECK(count(listed.begin(), listed.end(), true) == TEST_EXAM_COUNT);
+}
+
+void test_answer_log_replay()
+{
+    // A session which wrote its answers to the log and then crashed, before submitting the exam
+    add_test_user("crashed_student", "Student", 'S');
+    Exam exam;
+    CHECK(add_test_exam(&exam, 3, time(NULL) - 60, "bc"));
+
+    char log_path[MAX_CHAR_ARR_LENGTH];
+    create_session_log_path(log_path, exam.id, "crashed_student");
+    {
+        AnswerLog answer_log(log_path, exam.id, "crashed_student");
+        CHECK(answer_log.is_open());
+        // The log of a running session can't be opened again
+        AnswerLog second_log(log_path, exam.id, "crashed_student");
+        CHECK(!second_log.is_open());
+
+        Answer answer;
+        memset(&answer, 0, sizeof(answer));
+        strcpy(answer.exam_id, exam.id);
+        strcpy(answer.username, "crashed_student");
+        answer.qnum = 1;
+        answer.is_multiple_choice = true;
+        answer.chosen = 'b';
+        CHECK(answer_log.append(&answer));
+        answer.qnum = 2;
+        answer.chosen = 'a';
+        CHECK(answer_log.append(&answer));
+        answer.qnum = 3;
+        answer.is_multiple_choice = false;
+        strcpy(answer.essay_answer, "Logged essay answer");
+        CHECK(answer_log.append(&answer));
+    }
+    // An answer partially written when the session crashed
+    FILE *log_file = fopen(log_path, "ab");
+    CHECK(log_file != NULL);
+    if (log_file != NULL)
+    {
+        fwrite("\x20\x00\x00\x00garbage", 1, 11, log_file);
+        fclose(log_file);
+    }
+
+    CHECK(!has_taken_exam("crashed_student", exam.id));
+    CHECK(replay_answer_logs() == 1);
+    CHECK(has_taken_exam("crashed_student", exam.id));
+    CHECK(!filesystem::exists(log_path));
+
+    char results_path[MAX_CHAR_ARR_LENGTH], answers_path[MAX_CHAR_ARR_LENGTH];
+    create_examR_path(results_path, exam.id);
+    create_examA_path(answers_path, exam.id);
+    RecordFile<Result> results_file(results_path);
+    CHECK(results_file.size() == 1);
+    if (results_file.size() == 1)
+    {
+        CHECK(strcmp(results_file[0].username, "crashed_student") == 0);
+        CHECK(results_file[0].correct_choices_count == 1 && results_file[0].wrong_choices_count == 1);
+    }
+    AnswerReader answers_file(answers_path);
+    AnswerRecord answer;
+    CHECK(answers_file.next(&answer) && answer.qnum == 3 && strcmp(answer.essay_answer, "Logged essay answer") == 0);
+
+    // Replaying the submission again doesn't save it twice
+    CHECK(replay_answer_logs() == 0);
+    int submit_status = submit_exam(&exam, "crashed_student", "ba", NULL, 0);
+    CHECK(submit_status == 1);
+
+    // A session which crashed after the first answer, and one which crashed before any answer
+    add_test_user("early_student", "Student", 'S');
+    CHECK(add_test_exam(&exam, 3, time(NULL) - 60, "abc"));
+    char early_log_path[MAX_CHAR_ARR_LENGTH];
+    create_session_log_path(early_log_path, exam.id, "early_student");
+    create_session_log_path(log_path, exam.id, "crashed_student");
+    {
+        AnswerLog early_log(early_log_path, exam.id, "early_student");
+        AnswerLog empty_log(log_path, exam.id, "crashed_student");
+        Answer answer;
+        memset(&answer, 0, sizeof(answer));
+        strcpy(answer.exam_id, exam.id);
+        strcpy(answer.username, "early_student");
+        answer.qnum = 1;
+        answer.is_multiple_choice = true;
+        answer.chosen = 'a';
+        CHECK(early_log.append(&answer));
+    }
+
+    CHECK(replay_answer_logs() == 2);
+    CHECK(!filesystem::exists(early_log_path) && !filesystem::exists(log_path));
+    // The questions after the last answer count as blank, the empty log isn't submitted
+    CHECK(has_taken_exam("early_student", exam.id));
+    CHECK(!has_taken_exam("crashed_student", exam.id));
+    create_examR_path(results_path, exam.id);
+    RecordFile<Result> early_results_file(results_path);
+    CHECK(early_results_file.size() == 1);
+    if (early_results_file.size() == 1)
+    {
+        CHECK(early_results_file[0].correct_choices_count == 1 && early_results_file[0].wrong_choices_count == 0);
+        CHECK(early_results_file[0].multiple_choice_count == 3);
+    }
+}
+
+void test_regrade_old_answers()
+{
+    // An exam taken before the upgrade, its multiple choice answers are still in the old answers file
+    Exam exam;
+    CHECK(add_test_exam(&exam, 3, time(NULL) - 60, "bc"));
+    vector<Answer> old_answers(2);
+    for (size_t i = 0; i < old_answers.size(); i++)
+    {
+        memset(&old_answers[i], 0, sizeof(Answer));
+        strcpy(old_answers[i].exam_id, exam.id);
+        strcpy(old_answers[i].username, "old_student");
+        old_answers[i].qnum = i + 1;
+        old_answers[i].is_multiple_choice = true;
+    }
+    old_answers[0].chosen = 'b';
+    old_answers[1].chosen = 'a';
+    Result result;
+    memset(&result, 0, sizeof(result));
+    strcpy(result.username, "old_student");
+    strcpy(result.exam_id, exam.id);
+
+    char answers_path[MAX_CHAR_ARR_LENGTH], results_path[MAX_CHAR_ARR_LENGTH];
+    create_examA_path(answers_path, exam.id);
+    create_examR_path(results_path, exam.id);
+    CHECK(replace_file(answers_path, string((const char *)old_answers.data(), old_answers.size() * sizeof(Answer))));
+    CHECK(replace_file(results_path, string((const char *)&result, sizeof(result))));
+
+    CHECK(regrade_exam(exam.id) == 1);
+    RecordFile<Result> results_file(results_path);
+    CHECK(results_file.size() == 1);
+    if (results_file.size() == 1)
+    {
+        CHECK(results_file[0].correct_choices_count == 1 && results_file[0].wrong_choices_count == 1);
+        CHECK(results_file[0].multiple_choice_count == 2);
+    }
+}
+
+void add_test_user(const char *username, const char *lname, char role)
+{
+    User user;
+    memset(&user, 0, sizeof(user));
+    strcpy(user.username, username);
+    strcpy(user.fname, "First");
+    strcpy(user.lname, lname);
+    strcpy(user.password, "password123");
+    user.role = role;
+    RecordFile<User> users_file("./data/users.dat", true);
+    CHECK(users_file.append(&user) == 1);
+}
+
+bool add_test_exam(Exam *exam, unsigned int qcount, time_t start_time, const char *correct_options)
+{
+    /* Adds an exam like add_exam(), the questions with a correct option in correct_options are multiple choice
+     * questions and the rest are essay questions
+     */
+    memset(exam, 0, sizeof(*exam));
+    strcpy(exam->name, "Test exam");
+    strcpy(exam->creator_username, "professor");
+    exam->qcount = qcount;
+    exam->start_time = start_time;
+    exam->end_time = start_time + 3600;
+
+    vector<Question> questions(qcount);
+    for (unsigned int q = 0; q < qcount; q++)
+    {
+        memset(&questions[q], 0, sizeof(Question));
+        questions[q].qnum = q + 1;
+        questions[q].is_multiple_choice = q < strlen(correct_options);
+        if (questions[q].is_multiple_choice) questions[q].correct = correct_options[q];
+        snprintf(questions[q].question, sizeof(questions[q].question), "Question %u", q + 1);
+    }
+
+    char questions_path[MAX_CHAR_ARR_LENGTH];
+    generate_exam_id(exam);
+    create_examQ_path(questions_path, exam->id);
+    return replace_file(questions_path, string((const char *)questions.data(), questions.size() * sizeof(Question))) &&
+           create_exam_files(exam) && save_exam(exam);
+}